@@ -0,0 +1,111 @@
+#include "bench.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+static double median(std::vector<double> values)
+{
+	std::sort(values.begin(), values.end());
+	std::size_t middle{values.size() / 2};
+	if (values.size() % 2 == 0)
+		return (values[middle - 1] + values[middle]) / 2.0;
+	return values[middle];
+}
+
+double Bench::measure(const Function &function, std::uint64_t n)
+{
+	using clock_t = std::chrono::steady_clock;
+	auto begin{clock_t::now()};
+	function(n);
+	return std::chrono::duration<double>{clock_t::now() - begin}.count();
+}
+
+void Bench::add(const std::string &name, Function function)
+{
+	benchmarks.emplace_back(name, std::move(function));
+}
+
+std::vector<Bench::Result> Bench::run(const std::string &filter)
+{
+	std::vector<Result> results;
+	for (auto &[name, function] : benchmarks)
+	{
+		if (name.find(filter) == std::string::npos)
+			continue;
+
+		// Grow the batch until it is long enough for the clock
+		std::uint64_t n{1};
+		double elapsed{measure(function, n)};
+		while (elapsed < batchTime && n < (std::uint64_t{1} << 40))
+		{
+			double factor{elapsed > 0.0 ? batchTime / elapsed : 10.0};
+			n = static_cast<std::uint64_t>(n * std::clamp(factor * 1.2, 1.5, 10.0));
+			elapsed = measure(function, n);
+		}
+
+		for (int i{0}; i < warmup; ++i)
+			measure(function, n);
+
+		std::vector<double> samples;
+		for (int i{0}; i < repetitions; ++i)
+			samples.push_back(measure(function, n) * 1e9 / n);
+
+		double middle{median(samples)};
+		std::vector<double> deviations;
+		for (double sample : samples)
+			deviations.push_back(std::abs(sample - middle));
+
+		results.push_back({name, middle, median(deviations), n});
+	}
+	return results;
+}
+
+void Bench::saveBaseline(const std::string &path, const std::vector<Result> &results)
+{
+	std::ofstream ofs{path};
+	if (!ofs)
+		throw std::runtime_error{"Bench::saveBaseline() failed: cannot open \"" + path + '\"'};
+
+	ofs << "{\n" << std::setprecision(6);
+	for (std::size_t i{0}; i < results.size(); ++i)
+	{
+		ofs << "\t\"" << results[i].name << "\": " << results[i].median;
+		if (i + 1 < results.size())
+			ofs << ',';
+		ofs << '\n';
+	}
+	ofs << "}\n";
+}
+
+std::map<std::string, double> Bench::loadBaseline(const std::string &path)
+{
+	std::ifstream ifs{path};
+	if (!ifs)
+		throw std::runtime_error{"Bench::loadBaseline() failed: cannot open \"" + path + '\"'};
+
+	// Only the flat object written by saveBaseline() is understood
+	std::map<std::string, double> baseline;
+	std::string line;
+	while (std::getline(ifs, line))
+	{
+		std::size_t nameBegin{line.find('"')};
+		if (nameBegin == std::string::npos)
+			continue;
+		std::size_t nameEnd{line.find('"', nameBegin + 1)};
+		std::size_t colon{line.find(':', nameEnd)};
+		if (nameEnd == std::string::npos || colon == std::string::npos)
+			throw std::runtime_error{"Bench::loadBaseline() failed: malformed line \"" + line + '\"'};
+
+		std::istringstream value{line.substr(colon + 1)};
+		double median;
+		if (!(value >> median))
+			throw std::runtime_error{"Bench::loadBaseline() failed: malformed line \"" + line + '\"'};
+		baseline[line.substr(nameBegin + 1, nameEnd - nameBegin - 1)] = median;
+	}
+	return baseline;
+}
@@ -0,0 +1,62 @@
+#ifndef BENCH_HPP
+#define BENCH_HPP
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+/*
+ * A small statistical benchmark runner
+ *
+ * Each benchmark is a function running the measured operation n times.
+ * The runner first finds n such that one batch takes about batchTime,
+ * runs warmup batches, then measures repetitions batches,
+ * and reports the median and the median absolute deviation (MAD) in ns per operation.
+ */
+class Bench
+{
+public:
+	using Function = std::function<void(std::uint64_t n)>;
+
+	struct Result
+	{
+		std::string name;
+		double median; // ns/op
+		double mad;    // ns/op
+		std::uint64_t batchSize;
+	};
+
+private:
+	static constexpr double batchTime{2e-3}; // seconds
+	static constexpr int warmup{3};
+	static constexpr int repetitions{31};
+
+	std::vector<std::pair<std::string, Function> > benchmarks;
+
+	static double measure(const Function &function, std::uint64_t n);
+
+public:
+	void add(const std::string &name, Function function);
+	// Run the benchmarks whose name contains filter
+	std::vector<Result> run(const std::string &filter);
+
+	// Baseline files map benchmark names to median ns/op
+	static void saveBaseline(const std::string &path, const std::vector<Result> &results);
+	static std::map<std::string, double> loadBaseline(const std::string &path);
+};
+
+// Keep the compiler from optimizing away a value
+template <typename T>
+inline void doNotOptimize(const T &value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	asm volatile("" : : "r,m"(value) : "memory");
+#else
+	static volatile const void *sink;
+	sink = &value;
+#endif
+}
+
+#endif // ifndef BENCH_HPP
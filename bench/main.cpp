@@ -0,0 +1,249 @@
+#include "bench.hpp"
+#include "config.hpp"
+#include "io.hpp"
+#include "level.hpp"
+#include "line_shape.hpp"
+#include "surface.hpp"
+#include "vec.hpp"
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+/*
+ * Usage: saltfish_bench [--filter text] [--save file] [--compare file] [--threshold ratio]
+ *
+ * --save writes the results as a baseline file,
+ * --compare flags benchmarks slower than the baseline by more than threshold (default 0.1),
+ * and exits with 1 if there is any.
+ */
+
+static void addBenchmarks(Bench &bench)
+{
+	bench.add("Vec2d arithmetic", [](std::uint64_t n)
+	          {
+	          	Vec2d position{0.0, 0.0};
+	          	Vec2d velocity{0.5, -0.25};
+	          	for (std::uint64_t i{0}; i < n; ++i)
+	          	{
+	          		position += velocity * 0.016;
+	          		position = (position - velocity) / 1.0001;
+	          		doNotOptimize(position);
+	          	}
+	          });
+
+	bench.add("LineShape::draw", [](std::uint64_t n)
+	          {
+	          	sw::Surface surface{512, 512};
+	          	for (std::uint64_t i{0}; i < n; ++i)
+	          	{
+	          		double offset{static_cast<double>(i % 256)};
+	          		LineShape line{{offset, 0.0}, {511.0 - offset, 511.0}};
+	          		line.draw({255, 255, 255, 255}, surface);
+	          	}
+	          	doNotOptimize(surface.getPixels());
+	          });
+
+	bench.add("PixelView write", [](std::uint64_t n)
+	          {
+	          	sw::Surface surface{256, 256};
+	          	for (std::uint64_t i{0}; i < n; ++i)
+	          		surface(i & 255, (i >> 8) & 255) = {static_cast<Uint8>(i), 0, 0, 255};
+	          	doNotOptimize(surface.getPixels());
+	          });
+
+	bench.add("PixelView read", [](std::uint64_t n)
+	          {
+	          	sw::Surface surface{256, 256};
+	          	surface.fillRect(nullptr, {10, 20, 30, 255});
+	          	unsigned sum{0};
+	          	for (std::uint64_t i{0}; i < n; ++i)
+	          	{
+	          		sw::Color color = surface(i & 255, (i >> 8) & 255);
+	          		sum += color.r;
+	          	}
+	          	doNotOptimize(sum);
+	          });
+
+	bench.add("serial/deserial double", [](std::uint64_t n)
+	          {
+	          	std::vector<std::byte> buffer;
+	          	buffer.reserve(8);
+	          	for (std::uint64_t i{0}; i < n; ++i)
+	          	{
+	          		buffer.clear();
+	          		serial(static_cast<double>(i) * 0.5, buffer);
+	          		double value;
+	          		std::size_t index{0};
+	          		deserial(value, buffer, index);
+	          		doNotOptimize(value);
+	          	}
+	          });
+
+	bench.add("tokenize", [](std::uint64_t n)
+	          {
+	          	const std::string line{"window.title = \"saltfish \\\"editor\\\"\" 1280 720 -0.5"};
+	          	Tokens tokens;
+	          	for (std::uint64_t i{0}; i < n; ++i)
+	          	{
+	          		tokenize(line, tokens);
+	          		doNotOptimize(tokens);
+	          	}
+	          });
+
+	bench.add("tokenize long tokens", [](std::uint64_t n)
+	          {
+	          	const std::string line{"level.description = \"" + std::string(4096, 'x') + "\" " + std::string(4096, 'y')};
+	          	Tokens tokens;
+	          	for (std::uint64_t i{0}; i < n; ++i)
+	          	{
+	          		tokenize(line, tokens);
+	          		doNotOptimize(tokens);
+	          	}
+	          });
+
+	bench.add("Config::get", [](std::uint64_t n)
+	          {
+	          	Log logger{Log::error};
+	          	Config config{logger};
+	          	config.set("frame.idleTimeout", "500");
+	          	for (std::uint64_t i{0}; i < n; ++i)
+	          	{
+	          		int value{0};
+	          		config.get("frame.idleTimeout", value);
+	          		doNotOptimize(value);
+	          	}
+	          });
+
+	bench.add("Config::Handle::get", [](std::uint64_t n)
+	          {
+	          	Log logger{Log::error};
+	          	Config config{logger};
+	          	config.set("frame.idleTimeout", "500");
+	          	Config::Handle<int> handle{config.declare<int>("frame.idleTimeout", 0)};
+	          	for (std::uint64_t i{0}; i < n; ++i)
+	          	{
+	          		int value{handle.get()};
+	          		doNotOptimize(value);
+	          	}
+	          });
+
+	bench.add("Level::pickVertex/pickLine 65536 vertices", [](std::uint64_t n)
+	          {
+	          	Log logger{Log::error};
+	          	Level level{logger, {}};
+	          	Level::Batch batch;
+	          	for (uint32_t i{0}; i < Level::maxVertices; ++i)
+	          	{
+	          		batch.vertices.push_back({static_cast<double>(i & 255), static_cast<double>(i >> 8)});
+	          		if ((i & 255) != 255)
+	          			batch.lines.push_back({static_cast<uint16_t>(i), static_cast<uint16_t>(i + 1)});
+	          	}
+	          	level.apply(batch);
+	          	for (std::uint64_t i{0}; i < n; ++i)
+	          	{
+	          		Vec2d point{static_cast<double>(i * 37 % 256) + 0.3, static_cast<double>(i * 101 % 256) + 0.1};
+	          		doNotOptimize(level.pickVertex(point, 0.5));
+	          		doNotOptimize(level.pickLine(point, 0.5));
+	          	}
+	          });
+
+	bench.add("Surface::blit 256x256", [](std::uint64_t n)
+	          {
+	          	sw::Surface source{256, 256};
+	          	sw::Surface destination{512, 512};
+	          	source.setBlendMode(SDL_BLENDMODE_NONE);
+	          	for (std::uint64_t i{0}; i < n; ++i)
+	          	{
+	          		// NOTE: blit() overwrites dstrect with the clipped rectangle
+	          		sw::Rect dstRect{static_cast<int>(i % 256), 128, 0, 0};
+	          		source.blit(destination, nullptr, &dstRect);
+	          	}
+	          	doNotOptimize(destination.getPixels());
+	          });
+}
+
+static constexpr const char *usage{"Usage: saltfish_bench [--filter text] [--save file] [--compare file] [--threshold ratio]"};
+
+int main(int argc, char *argv[])
+{
+	std::string filter;
+	std::string savePath;
+	std::string comparePath;
+	double threshold{0.1};
+	for (int i{1}; i < argc; ++i)
+	{
+		std::string arg{argv[i]};
+		if (i + 1 >= argc)
+		{
+			std::cerr << "Missing value for " << arg << '\n' << usage << std::endl;
+			return 2;
+		}
+
+		if (arg == "--filter")
+			filter = argv[++i];
+		else if (arg == "--save")
+			savePath = argv[++i];
+		else if (arg == "--compare")
+			comparePath = argv[++i];
+		else if (arg == "--threshold")
+		{
+			try
+			{
+				threshold = std::stod(argv[++i]);
+			}
+			catch (const std::logic_error&) // std::invalid_argument or std::out_of_range
+			{
+				std::cerr << "Invalid value for " << arg << ": " << argv[i] << '\n' << usage << std::endl;
+				return 2;
+			}
+		}
+		else
+		{
+			std::cerr << "Unknown option " << arg << '\n' << usage << std::endl;
+			return 2;
+		}
+	}
+
+	try
+	{
+		Bench bench;
+		addBenchmarks(bench);
+		std::vector<Bench::Result> results{bench.run(filter)};
+
+		std::map<std::string, double> baseline;
+		if (!comparePath.empty())
+			baseline = Bench::loadBaseline(comparePath);
+
+		bool regressed{false};
+		std::cout << std::fixed << std::setprecision(2);
+		for (const Bench::Result &result : results)
+		{
+			std::cout << std::left << std::setw(28) << result.name << std::right
+			          << std::setw(12) << result.median << " ns/op  +- "
+			          << std::setw(8) << result.mad << "  (" << result.batchSize << " ops/batch)";
+
+			auto it{baseline.find(result.name)};
+			if (it != baseline.end())
+			{
+				double change{result.median / it->second - 1.0};
+				std::cout << "  " << std::showpos << change * 100.0 << std::noshowpos << '%';
+				if (change > threshold)
+				{
+					std::cout << "  REGRESSION";
+					regressed = true;
+				}
+			}
+			std::cout << std::endl;
+		}
+
+		if (!savePath.empty())
+			Bench::saveBaseline(savePath, results);
+		return regressed ? 1 : 0;
+	}
+	catch (const std::runtime_error &exception)
+	{
+		std::cerr << exception.what() << std::endl;
+		return 2;
+	}
+}
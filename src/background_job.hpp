@@ -0,0 +1,92 @@
+#ifndef BACKGROUND_JOB_HPP
+#define BACKGROUND_JOB_HPP
+
+#include "profiler.hpp"
+#include "trace.hpp"
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <memory>
+#include <vector>
+
+/*
+ * Runs a function on a worker thread and keeps its result until taken.
+ *
+ * Starting a new job abandons the unfinished one,
+ * which is asked to stop through the flag passed to it.
+ * Abandoned jobs are only waited for when the BackgroundJob is destroyed,
+ * so the calling thread never blocks on them.
+ */
+template <typename T>
+class BackgroundJob
+{
+private:
+	std::future<T> result;
+	std::shared_ptr<std::atomic<bool> > cancelled;
+	std::vector<std::future<T> > abandoned;
+
+	void reap()
+	{
+		for (auto it{abandoned.begin()}; it != abandoned.end(); )
+		{
+			if (it->wait_for(std::chrono::seconds{0}) == std::future_status::ready)
+				it = abandoned.erase(it);
+			else
+				++it;
+		}
+	}
+
+public:
+	BackgroundJob() = default;
+	BackgroundJob(const BackgroundJob &job) = delete;
+	BackgroundJob& operator=(const BackgroundJob &job) = delete;
+
+	// NOTE: The future returned by std::async blocks on destruction
+	~BackgroundJob()
+	{
+		cancel();
+	}
+
+	// NOTE: job runs on ANOTHER THREAD, it MUST NOT capture anything shared by reference
+	void start(std::function<T(const std::atomic<bool> &cancelled)> job)
+	{
+		cancel();
+		cancelled = std::make_shared<std::atomic<bool> >(false);
+		result = std::async(std::launch::async, [job, flag{cancelled}]()
+		                    {
+		                    	Trace::setThreadName("worker");
+		                    	SAL_PROFILE("BackgroundJob");
+		                    	return job(*flag);
+		                    });
+	}
+
+	void cancel()
+	{
+		reap();
+		if (result.valid())
+		{
+			cancelled->store(true);
+			abandoned.push_back(std::move(result));
+		}
+	}
+
+	// true if a job is started and its result not yet taken
+	bool pending() const
+	{
+		return result.valid();
+	}
+
+	bool ready() const
+	{
+		return result.valid() && result.wait_for(std::chrono::seconds{0}) == std::future_status::ready;
+	}
+
+	// Rethrows the EXCEPTION thrown by the job
+	T take()
+	{
+		return result.get();
+	}
+};
+
+#endif // ifndef BACKGROUND_JOB_HPP
@@ -0,0 +1,179 @@
+#include "batch_runner.hpp"
+#include <cmath>
+#include <fstream>
+
+void BatchRunner::flush()
+{
+	if (batch.empty())
+		return;
+	errorLine = batchLine;
+	if (level.getVertices().size() + batch.vertices.size() > Level::maxVertices)
+		throw std::runtime_error{"BatchRunner: too many vertices"};
+
+	std::vector<std::size_t> invalid;
+	linesAdded += level.apply(batch, &invalid);
+	if (!invalid.empty())
+	{
+		errorLine = batchLineNumbers[invalid.front()];
+		throw std::runtime_error{"add-line: vertex does not exist or both vertices are the same ("
+		                         + std::to_string(invalid.size()) + " invalid lines in the batch)"};
+	}
+	batch.clear();
+	batchLineNumbers.clear();
+	errorLine = lineCount;
+}
+
+void BatchRunner::runCommand(const Tokens &tokens)
+{
+	std::string_view command{tokens[0]};
+	auto arguments{tokens.begin() + 1};
+	errorLine = lineCount;
+	if ((command == "add-vertex" || command == "add-line") && batch.empty())
+		batchLine = lineCount;
+
+	if (command == "add-vertex")
+	{
+		if (tokens.size() != 3)
+			throw std::runtime_error{"add-vertex: wrong number of arguments"};
+		double x, y;
+		convertTokens(arguments, tokens.end(), x, y);
+		batch.vertices.push_back({x, y});
+		return;
+	}
+	if (command == "add-line")
+	{
+		if (tokens.size() != 3)
+			throw std::runtime_error{"add-line: wrong number of arguments"};
+		uint16_t v0, v1;
+		convertTokens(arguments, tokens.end(), v0, v1);
+		batch.lines.push_back({v0, v1});
+		batchLineNumbers.push_back(lineCount);
+		return;
+	}
+
+	// The other commands work on the level with the batch applied
+	flush();
+
+	if (command == "clear")
+	{
+		level.clear();
+	}
+	else if (command == "load" || command == "save")
+	{
+		if (tokens.size() != 2)
+			throw std::runtime_error{std::string{command} + ": wrong number of arguments"};
+		std::string name{tokens[1]};
+		if (command == "load")
+		{
+			level.clear();
+			if (!level.load(name))
+				throw std::runtime_error{"load: Level::load() failed"};
+		}
+		else if (!level.save(name))
+		{
+			throw std::runtime_error{"save: Level::save() failed"};
+		}
+	}
+	else if (command == "remove")
+	{
+		if (tokens.size() < 3)
+			throw std::runtime_error{"remove: wrong number of arguments"};
+		std::string_view kind{tokens[1]};
+		if (kind == "vertex")
+		{
+			std::vector<uint16_t> indices(tokens.size() - 2);
+			for (std::size_t i{0}; i < indices.size(); ++i)
+				convertToken(tokens[i + 2], indices[i]);
+			level.removeVertices(indices);
+		}
+		else if (kind == "line")
+		{
+			if (tokens.size() != 4)
+				throw std::runtime_error{"remove line: wrong number of arguments"};
+			uint16_t v0, v1;
+			convertTokens(tokens.begin() + 2, tokens.end(), v0, v1);
+			level.removeLines({{v0, v1}});
+		}
+		else
+		{
+			throw std::runtime_error{"remove: expecting vertex or line"};
+		}
+	}
+	else if (command == "transform")
+	{
+		if (tokens.size() < 3)
+			throw std::runtime_error{"transform: wrong number of arguments"};
+		std::string_view kind{tokens[1]};
+		std::size_t first{4}; // of the vertex IDs
+		Level::Transform transform;
+		if (kind == "rotate")
+		{
+			double degrees;
+			convertToken(tokens[2], degrees);
+			transform = Level::Transform::rotate(degrees * std::acos(-1.0) / 180.0);
+			first = 3;
+		}
+		else if (kind == "translate" || kind == "scale")
+		{
+			if (tokens.size() < 4)
+				throw std::runtime_error{"transform: wrong number of arguments"};
+			double x, y;
+			convertTokens(tokens.begin() + 2, tokens.begin() + 4, x, y);
+			transform = kind == "translate" ? Level::Transform::translate({x, y}) : Level::Transform::scale(x, y);
+		}
+		else
+		{
+			throw std::runtime_error{"transform: expecting translate, scale, or rotate"};
+		}
+
+		std::vector<uint16_t> indices(tokens.size() - first);
+		for (std::size_t i{0}; i < indices.size(); ++i)
+			convertToken(tokens[i + first], indices[i]);
+		level.transformVertices(indices, transform);
+	}
+	else
+	{
+		throw std::runtime_error{"unknown command \"" + std::string{command} + '\"'};
+	}
+}
+
+BatchRunner::BatchRunner(Log &logger, Level &level) : logger{logger}, level{level}, batchLine{0}, lineCount{0}, errorLine{0}, commands{0}, linesAdded{0}
+{
+}
+
+bool BatchRunner::run(const std::filesystem::path &script)
+{
+	std::ifstream file{script};
+	if (!file)
+	{
+		WRITE_LOG(logger, Log::error, "BatchRunner::run() failed: cannot open \"" << script.string() << '\"' << std::endl);
+		return false;
+	}
+
+	std::string line;
+	Tokens tokens;
+	lineCount = 0;
+	try
+	{
+		while (std::getline(file, line))
+		{
+			++lineCount;
+			tokenize(line, tokens);
+			if (tokens.empty() || (!tokens[0].empty() && tokens[0].front() == '#'))
+				continue;
+			runCommand(tokens);
+			++commands;
+		}
+		flush();
+	}
+	catch (const std::exception &exception)
+	{
+		WRITE_LOG(logger, Log::error, "BatchRunner::run() failed at line " << errorLine << " of \""
+		       << script.string() << "\": " << exception.what() << std::endl);
+		return false;
+	}
+
+	WRITE_LOG(logger, Log::info, "BatchRunner: ran " << commands << " commands, " << level.getVertices().size()
+	       << " vertices and " << level.getLines().size() << " lines in the level (" << linesAdded << " lines added)" << std::endl);
+	return true;
+}
@@ -0,0 +1,56 @@
+#ifndef BATCH_RUNNER_HPP
+#define BATCH_RUNNER_HPP
+
+#include "io.hpp"
+#include "level.hpp"
+#include "log.hpp"
+#include <filesystem>
+#include <string_view>
+#include <vector>
+
+/*
+ * Runs a script of level editing commands without any window, for generating and patching levels,
+ * started by "saltfish --batch <script>".
+ *
+ * One command per line, lines beginning with # are comments:
+ * clear
+ * load <name>                              (as Level::load(), after clearing)
+ * save <name>
+ * add-vertex <x> <y>
+ * add-line <v0> <v1>                       (IDs of vertices, may be added by earlier add-vertex)
+ * remove vertex <v>...
+ * remove line <v0> <v1>
+ * transform translate <dx> <dy> [<v>...]   (all vertices if none is given)
+ * transform scale <sx> <sy> [<v>...]
+ * transform rotate <degrees> [<v>...]
+ *
+ * Consecutive add-vertex and add-line are collected into one Level::Batch,
+ * applied when another command needs the level, so lines are not checked one by one;
+ * duplicated lines are skipped, an invalid line fails the batch at the line it was added by.
+ */
+class BatchRunner
+{
+private:
+	Log &logger;
+	Level &level;
+	Level::Batch batch;
+	int batchLine; // of the script, where the batch began
+	std::vector<int> batchLineNumbers; // of the script, for each line of the batch
+
+	int lineCount;
+	int errorLine; // reported if a command fails
+	std::size_t commands;
+	std::size_t linesAdded;
+
+	void flush();
+	// NOTE: Throws std::runtime_error if the command is invalid or failed.
+	void runCommand(const Tokens &tokens);
+
+public:
+	BatchRunner(Log &logger, Level &level);
+
+	// Return false if the script cannot be read or a command failed, the rest of the script is not run
+	bool run(const std::filesystem::path &script);
+};
+
+#endif // ifndef BATCH_RUNNER_HPP
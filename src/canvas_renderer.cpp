@@ -0,0 +1,136 @@
+#include "canvas_renderer.hpp"
+#include "line_shape.hpp"
+#include "profiler.hpp"
+#include "trace.hpp"
+#include <cmath>
+
+std::uint64_t CanvasRenderer::submitted{0};
+std::uint64_t CanvasRenderer::shown{0};
+
+void CanvasRenderer::run()
+{
+	Trace::setThreadName("render");
+
+	std::unique_lock<std::mutex> lock{mutex};
+	while (true)
+	{
+		wake.wait(lock, [this](){ return stopping || queued; });
+		if (stopping)
+			return;
+
+		std::unique_ptr<Frame> frame{std::move(queued)};
+		std::uint64_t sequence{queuedSequence};
+		sw::Surface back{std::move(spare)};
+		rendering = true;
+		lock.unlock();
+
+		try
+		{
+			if (back && (back.getWidth() != frame->width || back.getHeight() != frame->height))
+				back.free();
+			if (!back)
+			{
+				back.create(frame->width, frame->height);
+				// The canvas is opaque, copied as is
+				back.setBlendMode(SDL_BLENDMODE_NONE);
+			}
+			render(*frame, back);
+		}
+		catch (const std::runtime_error &exception)
+		{
+			WRITE_LOG(logger, Log::error, "CanvasRenderer: dropped a frame: " << exception.what() << std::endl);
+			lock.lock();
+			rendering = false;
+			continue;
+		}
+
+		lock.lock();
+		rendering = false;
+		// A finished frame never swapped is replaced by the newer one
+		spare = std::move(ready);
+		ready = std::move(back);
+		readySequence = sequence;
+	}
+}
+
+void CanvasRenderer::render(const Frame &frame, sw::Surface &target)
+{
+	SAL_PROFILE("CanvasRenderer::render");
+	target.fillRect(nullptr, frame.background);
+	for (const auto &[p0, p1] : frame.segments)
+	{
+		LineShape line{p0, p1};
+		line.draw(frame.foreground, target);
+	}
+	for (const auto &[p0, p1] : frame.highlightedSegments)
+	{
+		LineShape line{p0, p1};
+		line.draw(frame.highlight, target);
+	}
+	for (const Vec2d &point : frame.highlightedPoints)
+	{
+		sw::Rect rect{static_cast<int>(std::round(point[0])) - 1, static_cast<int>(std::round(point[1])) - 1, 3, 3};
+		target.fillRect(&rect, frame.highlight);
+	}
+	SAL_COUNT(Trace::linesDrawn, frame.segments.size() + frame.highlightedSegments.size());
+}
+
+CanvasRenderer::CanvasRenderer(Log &logger)
+	: logger{logger}, queued{nullptr}, queuedSequence{0}, rendering{false}, stopping{false}, readySequence{0},
+	  thread{&CanvasRenderer::run, this}
+{
+}
+
+CanvasRenderer::~CanvasRenderer()
+{
+	{
+		std::lock_guard<std::mutex> lock{mutex};
+		stopping = true;
+	}
+	wake.notify_one();
+	thread.join();
+}
+
+void CanvasRenderer::submit(Frame &&frame)
+{
+	{
+		std::lock_guard<std::mutex> lock{mutex};
+		queued = std::make_unique<Frame>(std::move(frame));
+		queuedSequence = ++submitted;
+	}
+	wake.notify_one();
+}
+
+bool CanvasRenderer::isReady()
+{
+	std::lock_guard<std::mutex> lock{mutex};
+	return static_cast<bool>(ready);
+}
+
+bool CanvasRenderer::isBusy()
+{
+	std::lock_guard<std::mutex> lock{mutex};
+	return queued || rendering;
+}
+
+bool CanvasRenderer::swap(sw::Surface &front)
+{
+	std::lock_guard<std::mutex> lock{mutex};
+	if (!ready)
+		return false;
+
+	spare = std::move(front);
+	front = std::move(ready);
+	shown = readySequence;
+	return true;
+}
+
+std::uint64_t CanvasRenderer::getSubmitted()
+{
+	return submitted;
+}
+
+std::uint64_t CanvasRenderer::getShown()
+{
+	return shown;
+}
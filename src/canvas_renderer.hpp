@@ -0,0 +1,87 @@
+#ifndef CANVAS_RENDERER_HPP
+#define CANVAS_RENDERER_HPP
+
+#include "log.hpp"
+#include "surface.hpp"
+#include "vec.hpp"
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/*
+ * Rasterizes the editor canvas on its own thread
+ *
+ * The main thread submits an immutable description of a frame,
+ * the render thread draws it into the back buffer,
+ * and the main thread swaps the finished buffer to the front when it draws.
+ * Only the latest submitted frame is drawn, frames not yet started are replaced.
+ */
+class CanvasRenderer
+{
+public:
+	struct Frame
+	{
+		int width;
+		int height;
+		sw::Color foreground;
+		sw::Color background;
+		sw::Color highlight;
+		// In screen coordinates relative to the canvas
+		std::vector<std::pair<Vec2d, Vec2d> > segments;
+		// Drawn over segments with the highlight color
+		std::vector<std::pair<Vec2d, Vec2d> > highlightedSegments;
+		std::vector<Vec2d> highlightedPoints;
+	};
+
+private:
+	/*
+	 * Frames are numbered in the order submitted over all renderers,
+	 * so LatencyTracker can wait for the frame reflecting an event to be shown.
+	 * Only touched by the main thread.
+	 */
+	static std::uint64_t submitted;
+	static std::uint64_t shown;
+
+	Log &logger;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::unique_ptr<Frame> queued;
+	std::uint64_t queuedSequence;
+	bool rendering;
+	bool stopping;
+
+	// Finished but not yet swapped to the front, and a buffer to be reused
+	sw::Surface ready;
+	std::uint64_t readySequence;
+	sw::Surface spare;
+
+	// NOTE: Declared last, as the thread uses the members above
+	std::thread thread;
+
+	void run();
+	static void render(const Frame &frame, sw::Surface &target);
+
+public:
+	CanvasRenderer(Log &logger);
+	~CanvasRenderer();
+	CanvasRenderer(const CanvasRenderer&) = delete;
+	CanvasRenderer& operator=(const CanvasRenderer&) = delete;
+
+	void submit(Frame &&frame);
+	// true if a frame is finished and can be swapped
+	bool isReady();
+	// true if a frame is submitted but not yet finished
+	bool isBusy();
+	// Swap a finished frame into front, return false if there is none
+	bool swap(sw::Surface &front);
+
+	// Number of the last frame submitted, and of the last frame swapped to the front
+	static std::uint64_t getSubmitted();
+	static std::uint64_t getShown();
+};
+
+#endif // ifndef CANVAS_RENDERER_HPP
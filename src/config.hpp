@@ -4,28 +4,166 @@
 #include "log.hpp"
 #include "io.hpp"
 #include <fstream>
+#include <functional>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <set>
 #include <sstream>
+#include <stdexcept>
 #include <string>
+#include <type_traits>
 
 /*
  * A simple database to load configuration from files,
  * store them as strings, and convert them to appropriate types.
+ *
+ * Keys can also be declared with a type, a default, and a validator by declare(),
+ * their values are then parsed only once, when set or declared,
+ * and read through the returned Handle without any lookup.
  */
 class Config
 {
+public:
+	// Reads a declared key, valid as long as the Config
+	template <typename T>
+	class Handle
+	{
+	private:
+		const T *value;
+
+	public:
+		explicit Handle(const T &value) : value{&value}
+		{
+		}
+
+		const T& get() const
+		{
+			return *value;
+		}
+	};
+
 private:
+	struct SlotBase
+	{
+		virtual ~SlotBase() = default;
+		// Return false if value is invalid, then the slot is not changed
+		virtual bool parse(const std::string &value) = 0;
+	};
+
+	template <typename T>
+	struct Slot : SlotBase
+	{
+		T value;
+		std::function<bool(const T&)> validator;
+
+		Slot(const T &value, std::function<bool(const T&)> validator) : value{value}, validator{std::move(validator)}
+		{
+		}
+
+		bool parse(const std::string &value) final
+		{
+			T parsed{};
+			if constexpr (std::is_same_v<T, std::string>)
+			{
+				parsed = value;
+			}
+			else
+			{
+				std::istringstream valueStream{value};
+				if constexpr (std::is_unsigned_v<T> && !std::is_same_v<T, bool>)
+				{
+					// Extraction wraps negative numbers around instead of failing
+					if ((valueStream >> std::ws).peek() == '-')
+						return false;
+				}
+				valueStream >> parsed;
+				if constexpr (std::is_same_v<T, bool>)
+				{
+					// Both 0/1 and false/true
+					if (valueStream.fail())
+					{
+						valueStream.clear();
+						valueStream.seekg(0);
+						valueStream >> std::boolalpha >> parsed;
+					}
+				}
+				if (valueStream.fail() || !(valueStream >> std::ws).eof())
+					return false;
+			}
+
+			if (validator && !validator(parsed))
+				return false;
+			this->value = parsed;
+			return true;
+		}
+	};
+
 	Log &logger;
 	std::map<std::string, std::string> db;
+	std::map<std::string, std::unique_ptr<SlotBase> > slots;
+	/*
+	 * Keys already warned about by get(), which is often called every frame with the same key,
+	 * at most maxWarned, the warnings about further keys are only rate limited
+	 */
+	static constexpr std::size_t maxWarned{256};
+	mutable std::mutex warnedMutex;
+	mutable std::set<std::string> missingWarned;
+	mutable std::set<std::string> conversionWarned;
+
+	bool firstWarning(std::set<std::string> &warned, const std::string &key) const
+	{
+		std::lock_guard<std::mutex> lock{warnedMutex};
+		if (warned.size() >= maxWarned)
+			return warned.count(key) == 0;
+		return warned.insert(key).second;
+	}
+
+	void parseSlot(const std::string &key, SlotBase &slot, const std::string &value)
+	{
+		if (!slot.parse(value))
+		{
+			WRITE_LOG(logger, Log::warning,
+			          "Config: invalid value \"" << value << "\" for \"" << key << "\", using the default" << std::endl);
+		}
+	}
 
 public:
 	Config (Log &logger) : logger{logger}
 	{
 	}
 
+	/*
+	 * Declare key as of type T, which is defaultValue unless set to a value that can be parsed and is valid
+	 * NOTE: Throws std::runtime_error if key is already declared with another type.
+	 */
+	template <typename T>
+	Handle<T> declare(const std::string &key, const T &defaultValue, std::function<bool(const T&)> validator = {})
+	{
+		auto found{slots.find(key)};
+		if (found != slots.end())
+		{
+			Slot<T> *slot{dynamic_cast<Slot<T>*>(found->second.get())};
+			if (!slot)
+				throw std::runtime_error{"Config::declare() failed: \"" + key + "\" is declared with another type"};
+			return Handle<T>{slot->value};
+		}
+
+		auto slot{std::make_unique<Slot<T> >(defaultValue, std::move(validator))};
+		Handle<T> handle{slot->value};
+		auto value{db.find(key)};
+		if (value != db.end())
+			parseSlot(key, *slot, value->second);
+		slots.emplace(key, std::move(slot));
+		return handle;
+	}
+
 	void set(const std::string &key, const std::string &value)
 	{
 		db[key] = value;
+		auto slot{slots.find(key)};
+		if (slot != slots.end())
+			parseSlot(key, *slot->second, value);
 	}
 
 	bool loadFromFile(const std::string &fileName)
@@ -40,12 +178,13 @@ public:
 		}
 
 		int lineCount{1};
+		std::string line;
+		Tokens tokens;
 		while (inFile)
 		{
-			std::string line;
 			std::getline(inFile, line);
 
-			auto tokens{tokenize(line)};
+			tokenize(line, tokens);
 			if (tokens.size() == 0)
 			{
 				continue;
@@ -58,12 +197,9 @@ public:
 				continue;
 			}
 
-			auto it{tokens.begin()};
-			const std::string &key{*it};
-			++it;
-			const std::string &op{*it};
-			++it;
-			const std::string &value{*it};
+			std::string_view key{tokens[0]};
+			std::string_view op{tokens[1]};
+			std::string_view value{tokens[2]};
 			if (op != "=")
 			{
 				WRITE_LOG(logger, Log::warning,
@@ -72,7 +208,7 @@ public:
 				continue;
 			}
 
-			set(key, value);
+			set(std::string{key}, std::string{value});
 
 			++lineCount;
 		}
@@ -80,6 +216,7 @@ public:
 		return true;
 	}
 
+	// Parses the value on every call, use declare() for values read often
 	template <typename T>
 	bool get(const std::string &key, T &target) const
 	{
@@ -90,17 +227,23 @@ public:
 		}
 		catch (std::out_of_range &exception)
 		{
-			WRITE_LOG(logger, Log::warning,
-			          "Config::get(): key \"" << key << "\" does not exist" << std::endl);
+			if (firstWarning(missingWarned, key))
+			{
+				WRITE_LOG_RATE(logger, Log::warning, 1,
+				               "Config::get(): key \"" << key << "\" does not exist" << std::endl);
+			}
 			return false;
 		}
 
 		valueStream >> target;
 		if (valueStream.fail())
 		{
-			WRITE_LOG(logger, Log::warning,
-			          "Config::get() failed to access \"" << key
-			       << "\" as \"" << typeid(T).name() << "\"" << std::endl);
+			if (firstWarning(conversionWarned, key))
+			{
+				WRITE_LOG_RATE(logger, Log::warning, 1,
+				               "Config::get() failed to access \"" << key
+				            << "\" as \"" << typeid(T).name() << "\"" << std::endl);
+			}
 			return false;
 		}
 
@@ -1,5 +1,133 @@
 #include "editor.hpp"
+#include "profiler.hpp"
+#include "trace.hpp"
 #include <iostream>
+#include <numeric>
+
+namespace
+{
+	// Even-odd rule, polygon is closed implicitly
+	bool inside(const std::vector<Vec2d> &polygon, const Vec2d &point)
+	{
+		bool result{false};
+		for (std::size_t i{0}, j{polygon.size() - 1}; i < polygon.size(); j = i++)
+		{
+			const Vec2d &p0{polygon[i]};
+			const Vec2d &p1{polygon[j]};
+			if (   (p0[1] > point[1]) != (p1[1] > point[1])
+			    && point[0] < (p1[0] - p0[0]) * (point[1] - p0[1]) / (p1[1] - p0[1]) + p0[0])
+			{
+				result = !result;
+			}
+		}
+		return result;
+	}
+}
+
+template <std::size_t capacity>
+Editor::Status::Field<capacity>::Field() : size{0}
+{
+}
+
+template <std::size_t capacity>
+bool Editor::Status::Field<capacity>::set(std::string_view content)
+{
+	content = content.substr(0, capacity);
+	if (get() == content)
+		return false;
+
+	std::copy(content.begin(), content.end(), buffer.begin());
+	size = content.size();
+	return true;
+}
+
+template <std::size_t capacity>
+std::string_view Editor::Status::Field<capacity>::get() const
+{
+	return {buffer.data(), size};
+}
+
+std::string_view Editor::Status::format(double value, std::array<char, numberCapacity> &buffer)
+{
+	auto [end, error]{std::to_chars(buffer.data(), buffer.data() + buffer.size(), value, std::chars_format::fixed, precision)};
+	if (error != std::errc{})
+		return "?";
+	return {buffer.data(), static_cast<std::size_t>(end - buffer.data())};
+}
+
+std::string_view Editor::Status::format(std::size_t value, std::array<char, numberCapacity> &buffer)
+{
+	auto [end, error]{std::to_chars(buffer.data(), buffer.data() + buffer.size(), value)};
+	if (error != std::errc{})
+		return "?";
+	return {buffer.data(), static_cast<std::size_t>(end - buffer.data())};
+}
+
+Editor::Status::Status() : changed{true}
+{
+}
+
+void Editor::Status::setTool(std::string_view name)
+{
+	changed |= tool.set(name);
+}
+
+void Editor::Status::setCoordinates(const Vec2d &coord)
+{
+	std::array<char, numberCapacity> buffer;
+	changed |= x.set(format(coord[0], buffer));
+	changed |= y.set(format(coord[1], buffer));
+}
+
+void Editor::Status::setZoom(double scale)
+{
+	std::array<char, numberCapacity> buffer;
+	changed |= zoom.set(format(scale, buffer));
+}
+
+void Editor::Status::setLock(bool hLocked, bool vLocked)
+{
+	if (hLocked)
+		changed |= lock.set(" H-locked");
+	else if (vLocked)
+		changed |= lock.set(" V-locked");
+	else
+		changed |= lock.set("");
+}
+
+void Editor::Status::show(std::string &target)
+{
+	if (changed)
+	{
+		std::array<char, lineCapacity> buffer;
+		std::size_t size{0};
+		for (std::string_view part : {tool.get(), std::string_view{": ("}, x.get(), std::string_view{","}, y.get(),
+		                              std::string_view{") 1:"}, zoom.get(), lock.get()})
+		{
+			std::size_t count{std::min(part.size(), buffer.size() - size)};
+			std::copy(part.begin(), part.begin() + count, buffer.begin() + size);
+			size += count;
+		}
+		line.set({buffer.data(), size});
+		changed = false;
+	}
+
+	if (target != line.get())
+		target.assign(line.get());
+}
+
+void Editor::Status::assignNumber(std::string &target, std::string_view prefix, double value)
+{
+	std::array<char, numberCapacity> buffer;
+	target.assign(prefix);
+	target.append(format(value, buffer));
+}
+
+void Editor::Status::appendCount(std::string &target, std::size_t count)
+{
+	std::array<char, numberCapacity> buffer;
+	target.append(format(count, buffer));
+}
 
 Editor::Tool::Field::~Field()
 {
@@ -96,6 +224,7 @@ std::tuple<bool, bool, std::unique_ptr<Editor::Tool> > Editor::Tool::handleEvent
 				editor.message = hLockedMessage;
 			else
 				editor.message = hUnlockedMessage;
+			editor.statusLine.setLock(editor.hLocked, editor.vLocked);
 			return {true, false, std::make_unique<NullTool>(editor)};
 
 		case SDLK_LALT:
@@ -103,6 +232,7 @@ std::tuple<bool, bool, std::unique_ptr<Editor::Tool> > Editor::Tool::handleEvent
 				editor.message = vLockedMessage;
 			else
 				editor.message = vUnlockedMessage;
+			editor.statusLine.setLock(editor.hLocked, editor.vLocked);
 			return {true, false, std::make_unique<NullTool>(editor)};
 
 		default:
@@ -140,7 +270,9 @@ std::tuple<bool, bool, std::unique_ptr<Editor::Tool> > Editor::Tool::handleEvent
 		int32_t zoomInput{event.wheel.y};
 		if (event.wheel.direction == SDL_MOUSEWHEEL_FLIPPED)
 			zoomInput = -zoomInput;
-		editor.message = "Zoom 1:" + std::to_string(editor.zoomView(zoomInput));
+		double scale{editor.zoomView(zoomInput)};
+		Status::assignNumber(editor.message, "Zoom 1:", scale);
+		editor.statusLine.setZoom(scale);
 		return {true, false, nullptr};
 	}
 
@@ -153,9 +285,8 @@ std::tuple<bool, bool, std::unique_ptr<Editor::Tool> > Editor::Tool::handleEvent
 
 void Editor::NullTool::showDefaultStatus()
 {
-	const Vec2d &coord{editor.getMouseReal()};
-	editor.status = defaultStatus;
-	editor.status += '(' + std::to_string(coord[0]) + ',' + std::to_string(coord[1]) + ')';
+	editor.statusLine.setCoordinates(editor.getMouseReal());
+	editor.statusLine.show(editor.status);
 }
 
 void Editor::NullTool::newLevel()
@@ -169,6 +300,7 @@ void Editor::NullTool::newLevel()
 
 Editor::NullTool::NullTool(Editor &editor) : Tool{editor}, confirmQuit{false}, confirmNew{false}
 {
+	editor.statusLine.setTool(toolName);
 	showDefaultStatus();
 }
 
@@ -229,6 +361,9 @@ std::tuple<bool, bool, std::unique_ptr<Editor::Tool> > Editor::NullTool::handleE
 		case 'o':
 			return {true, false, std::make_unique<OpenTool>(editor)};
 
+		case SDLK_s:
+			return {true, false, std::make_unique<SelectTool>(editor)};
+
 		default:
 			break;
 		}
@@ -329,6 +464,308 @@ std::tuple<bool, bool, std::unique_ptr<Editor::Tool> > Editor::OpenTool::handleE
 	return {false, false, nullptr};
 }
 
+void Editor::SelectTool::showStatus()
+{
+	editor.status = toolName;
+	editor.status += lasso ? lassoName : boxName;
+	Status::appendCount(editor.status, editor.getSelection().size());
+	editor.status += selectedName;
+}
+
+void Editor::SelectTool::select()
+{
+	SAL_PROFILE("Editor::SelectTool::select");
+	const std::vector<Vec2d> &band{editor.band};
+	KdTree::Box box{band.front(), band.front()};
+	for (const Vec2d &point : band)
+		box.extend({point, point});
+
+	std::vector<uint16_t> found{editor.game.level.findVertices(box)};
+	if (lasso)
+	{
+		const auto &vertices{editor.game.level.getVertices()};
+		found.erase(std::remove_if(found.begin(), found.end(),
+		                           [&band, &vertices](uint16_t index)
+		                           {
+		                           	return !inside(band, vertices[index]);
+		                           }),
+		            found.end());
+	}
+	editor.setSelection(std::move(found));
+}
+
+std::tuple<bool, bool, std::unique_ptr<Editor::Tool> > Editor::SelectTool::perform(Operation operation)
+{
+	if (editor.getSelection().empty())
+	{
+		editor.message = "Nothing selected";
+		return {true, false, nullptr};
+	}
+
+	this->operation = operation;
+	indices = editor.getSelection();
+	try
+	{
+		activate();
+	}
+	catch (const std::runtime_error &exception)
+	{
+		WRITE_LOG(editor.logger, Log::error, exception.what() << std::endl);
+		editor.message = "Error: ";
+		editor.message += exception.what();
+		this->operation = none;
+		return {true, false, nullptr};
+	}
+
+	switch (operation)
+	{
+	case remove:
+		editor.message = "Removed ";
+		break;
+	case move:
+		editor.message = "Moved ";
+		break;
+	default:
+		editor.message = "Duplicated ";
+		break;
+	}
+	Status::appendCount(editor.message, indices.size());
+	editor.message += " vertices";
+	return {true, true, std::make_unique<SelectTool>(editor, lasso)};
+}
+
+Editor::SelectTool::SelectTool(Editor &editor, bool lasso)
+	: Tool{editor}, lasso{lasso}, selecting{false}, pending{none}, operation{none}, firstDuplicate{0}
+{
+	showStatus();
+}
+
+std::tuple<bool, bool, std::unique_ptr<Editor::Tool> > Editor::SelectTool::handleEvent(const SDL_Event &event)
+{
+	bool done;
+	bool appendTo;
+	std::unique_ptr<Tool> next;
+	std::tie(done, appendTo, next) = Tool::handleEvent(event);
+	if (done)
+	{
+		if (next)
+		{
+			editor.band.clear();
+			editor.damage();
+		}
+		return {done, appendTo, std::move(next)};
+	}
+
+	switch (event.type)
+	{
+	case SDL_KEYDOWN:
+		switch (event.key.keysym.sym)
+		{
+		case SDLK_b:
+			lasso = false;
+			break;
+
+		case SDLK_l:
+			lasso = true;
+			break;
+
+		case SDLK_a:
+		{
+			std::vector<uint16_t> all(editor.game.level.getVertices().size());
+			std::iota(all.begin(), all.end(), 0);
+			editor.setSelection(std::move(all));
+			break;
+		}
+
+		case SDLK_c:
+			editor.setSelection({});
+			break;
+
+		case SDLK_x:
+			[[fallthrough]];
+		case SDLK_DELETE:
+			return perform(remove);
+
+		case SDLK_m:
+			[[fallthrough]];
+		case SDLK_d:
+			if (editor.getSelection().empty())
+			{
+				editor.message = "Nothing selected";
+				break;
+			}
+			pending = event.key.keysym.sym == SDLK_m ? move : duplicate;
+			anchor = editor.getMouseReal();
+			editor.status = pending == move ? movePromptStatus : duplicatePromptStatus;
+			return {true, false, nullptr};
+
+		default:
+			return {false, false, nullptr};
+		}
+		pending = none;
+		showStatus();
+		break;
+
+	case SDL_MOUSEBUTTONDOWN:
+		if (event.button.button == SDL_BUTTON_RIGHT)
+		{
+			selecting = true;
+			const Vec2d &mouse{editor.getMouseReal()};
+			if (lasso)
+				editor.band = {mouse};
+			else
+				editor.band = {mouse, mouse, mouse, mouse};
+		}
+		break;
+
+	case SDL_MOUSEMOTION:
+		if (selecting)
+		{
+			std::vector<Vec2d> &band{editor.band};
+			const Vec2d &mouse{editor.getMouseReal()};
+			if (lasso)
+			{
+				Vec2d step{(mouse - band.back()) / editor.view.scale};
+				if (step[0] * step[0] + step[1] * step[1] < lassoStep * lassoStep)
+					break;
+				band.push_back(mouse);
+			}
+			else
+			{
+				band[1] = {mouse[0], band[0][1]};
+				band[2] = mouse;
+				band[3] = {band[0][0], mouse[1]};
+			}
+			editor.damage();
+		}
+		break;
+
+	case SDL_MOUSEBUTTONUP:
+		if (event.button.button == SDL_BUTTON_RIGHT && selecting)
+		{
+			selecting = false;
+			select();
+			editor.band.clear();
+			editor.damage();
+			showStatus();
+		}
+		else if (event.button.button == SDL_BUTTON_LEFT && pending != none)
+		{
+			Operation operation{pending};
+			pending = none;
+			offset = editor.getMouseReal() - anchor;
+			return perform(operation);
+		}
+		break;
+
+	default:
+		break;
+	}
+
+	return {false, false, nullptr};
+}
+
+void Editor::SelectTool::activate()
+{
+	SAL_PROFILE("Editor::SelectTool::activate");
+	Level &level{editor.game.level};
+	const auto &vertices{level.getVertices()};
+	if (indices.empty() || indices.back() >= vertices.size())
+		throw std::runtime_error{"Editor::SelectTool::activate() failed: invalid selection"};
+
+	switch (operation)
+	{
+	case remove:
+	{
+		std::vector<bool> selected(vertices.size(), false);
+		removedVertices.clear();
+		removedLines.clear();
+		for (uint16_t index : indices)
+		{
+			selected[index] = true;
+			removedVertices.push_back(vertices[index]);
+		}
+		for (const Level::Line &line : level.getLines())
+		{
+			if (selected[line.v0] || selected[line.v1])
+				removedLines.push_back(line);
+		}
+		level.removeVertices(indices);
+		editor.setSelection({});
+		break;
+	}
+
+	case move:
+		level.transformVertices(indices, Level::Transform::translate(offset));
+		editor.setSelection(std::vector<uint16_t>{indices});
+		break;
+
+	case duplicate:
+	{
+		if (vertices.size() + indices.size() > Level::maxVertices)
+			throw std::runtime_error{"Editor::SelectTool::activate() failed: too many vertices"};
+
+		// ID of the copy of each vertex, or none
+		constexpr uint32_t copyNone{Level::maxVertices};
+		std::vector<uint32_t> copyOf(vertices.size(), copyNone);
+		Level::Batch batch;
+		firstDuplicate = vertices.size();
+		batch.vertices.reserve(indices.size());
+		for (uint16_t index : indices)
+		{
+			copyOf[index] = static_cast<uint32_t>(firstDuplicate + batch.vertices.size());
+			batch.vertices.push_back(vertices[index] + offset);
+		}
+		for (const Level::Line &line : level.getLines())
+		{
+			if (copyOf[line.v0] != copyNone && copyOf[line.v1] != copyNone)
+				batch.lines.push_back({static_cast<uint16_t>(copyOf[line.v0]), static_cast<uint16_t>(copyOf[line.v1])});
+		}
+		level.apply(batch);
+
+		std::vector<uint16_t> duplicates(indices.size());
+		std::iota(duplicates.begin(), duplicates.end(), static_cast<uint16_t>(firstDuplicate));
+		editor.setSelection(std::move(duplicates));
+		break;
+	}
+
+	default:
+		return;
+	}
+	editor.changed = true;
+}
+
+void Editor::SelectTool::undo()
+{
+	SAL_PROFILE("Editor::SelectTool::undo");
+	Level &level{editor.game.level};
+	switch (operation)
+	{
+	case remove:
+		if (!level.insertVertices(indices, removedVertices, removedLines))
+			throw std::runtime_error{"Editor::SelectTool::undo() failed: cannot insert the removed vertices"};
+		break;
+
+	case move:
+		level.transformVertices(indices, Level::Transform::translate(offset * -1.0));
+		break;
+
+	case duplicate:
+	{
+		std::vector<uint16_t> duplicates(indices.size());
+		std::iota(duplicates.begin(), duplicates.end(), static_cast<uint16_t>(firstDuplicate));
+		if (level.removeVertices(duplicates) != duplicates.size())
+			throw std::runtime_error{"Editor::SelectTool::undo() failed: cannot remove the duplicated vertices"};
+		break;
+	}
+
+	default:
+		return;
+	}
+	editor.setSelection(std::vector<uint16_t>{indices});
+	editor.changed = true;
+}
+
 Editor::History::History() : current{operations.end()}
 {
 }
@@ -386,8 +823,13 @@ Editor::Editor(const DoubleRect &dimension, Log &logger, sw::Window &window, Gam
 	  tool{std::make_unique<NullTool>(*this)},
 	  hLocked{false}, yAlign{-1}, vLocked{false}, xAlign{-1},
 	  xOrigin{-1}, yOrigin{-1},
+	  renderer{logger}, submittedRevision{game.level.getRevision()}, canvasStale{true},
+	  hoveredRevision{game.level.getRevision()}, selectionRevision{game.level.getRevision()},
 	  changed{false}, onExit{onExit}
 {
+	statusLine.setZoom(view.scale);
+	statusLine.setLock(hLocked, vLocked);
+	statusLine.show(status);
 }
 
 void Editor::handleEvent(const SDL_Event &event)
@@ -419,6 +861,7 @@ void Editor::handleEvent(const SDL_Event &event)
 		mouseReal *= view.scale;
 		mouseReal += view.origin;
 		toolHandleEvent(event);
+		updateHover();
 
 		xOrigin = event.motion.x;
 		yOrigin = event.motion.y;
@@ -441,26 +884,136 @@ void Editor::handleEvent(const SDL_Event &event)
 		break;
 	}
 
+	case SDL_MOUSEWHEEL:
+		toolHandleEvent(event);
+		updateHover();
+		break;
+
 	default:
 		toolHandleEvent(event);
 		break;
 	}
 }
 
-void Editor::draw(sw::Surface &surface)
+unsigned Editor::getEventMask()
 {
-	surface.fillRect(&real, backgroundColor);
-	sw::Surface tmp{real.w, real.h};
-	auto vertices{game.level.getVertices()};
+	return keyEvent | textEvent | pointerEvent | wheelEvent;
+}
+
+void Editor::submitCanvas()
+{
+	CanvasRenderer::Frame frame{real.w, real.h, foregroundColor, backgroundColor, selectionColor, {}, {}, {}};
+	const auto &vertices{game.level.getVertices()};
+
+	const std::vector<uint16_t> &selection{getSelection()};
+	std::vector<bool> selected;
+	if (!selection.empty())
+	{
+		selected.resize(vertices.size(), false);
+		frame.highlightedPoints.reserve(selection.size());
+		for (uint16_t index : selection)
+		{
+			selected[index] = true;
+			frame.highlightedPoints.push_back((vertices[index] - view.origin) / view.scale);
+		}
+	}
+
+	frame.segments.reserve(game.level.getLines().size());
 	for (const Level::Line &line : game.level.getLines())
 	{
-		LineShape lineDraw{
-		                  	(vertices[line.v0] - view.origin) / view.scale,
-							(vertices[line.v1] - view.origin) / view.scale
-		                  };
-		lineDraw.draw(foregroundColor, tmp);
+		auto &segments{!selected.empty() && selected[line.v0] && selected[line.v1] ? frame.highlightedSegments : frame.segments};
+		segments.emplace_back((vertices[line.v0] - view.origin) / view.scale,
+		                      (vertices[line.v1] - view.origin) / view.scale);
 	}
-	tmp.blit(surface, nullptr, &real);
+	renderer.submit(std::move(frame));
+
+	submittedRevision = game.level.getRevision();
+	canvasStale = false;
+}
+
+void Editor::updateHover()
+{
+	SAL_PROFILE("Editor::updateHover");
+	hoveredRevision = game.level.getRevision();
+
+	double eps{real.h * view.scale};
+	std::optional<uint16_t> vertex{game.level.pickVertex(mouseReal, vertexCanvasEps * eps)};
+	std::optional<Level::Line> line;
+	if (!vertex)
+		line = game.level.pickLine(mouseReal, lineCanvasEps * eps);
+
+	bool sameLine{line.has_value() == hoveredLine.has_value()
+	              && (!line || (line->v0 == hoveredLine->v0 && line->v1 == hoveredLine->v1))};
+	if (vertex == hoveredVertex && sameLine)
+		return;
+
+	hoveredVertex = vertex;
+	hoveredLine = line;
+	damage();
+}
+
+Vec2d Editor::toScreen(const Level::Vertex &vertex)
+{
+	return Vec2d{static_cast<double>(real.x), static_cast<double>(real.y)} + (vertex - view.origin) / view.scale;
+}
+
+void Editor::reInit(int wScreen, int hScreen)
+{
+	Widget::reInit(wScreen, hScreen);
+	canvasStale = true;
+}
+
+void Editor::draw(sw::Surface &surface)
+{
+	SAL_PROFILE("Editor::draw");
+	renderer.swap(canvas);
+	if (!canvas)
+	{
+		surface.fillRect(&real, backgroundColor);
+		return;
+	}
+
+	// The canvas may be smaller than the widget after resizing
+	if (canvas.getWidth() < real.w || canvas.getHeight() < real.h)
+		surface.fillRect(&real, backgroundColor);
+	// NOTE: blit() overwrites dstrect with the clipped rectangle
+	sw::Rect dstRect{real};
+	canvas.blit(surface, nullptr, &dstRect);
+
+	const auto &vertices{game.level.getVertices()};
+	if (hoveredVertex)
+	{
+		Vec2d center{toScreen(vertices[*hoveredVertex])};
+		sw::Rect rect{static_cast<int>(std::round(center[0])) - vertexHighlightSize,
+		              static_cast<int>(std::round(center[1])) - vertexHighlightSize,
+		              2 * vertexHighlightSize + 1, 2 * vertexHighlightSize + 1};
+		surface.fillRect(&rect, highlightColor);
+	}
+	if (hoveredLine)
+	{
+		LineShape line{toScreen(vertices[hoveredLine->v0]), toScreen(vertices[hoveredLine->v1])};
+		line.draw(highlightColor, surface);
+	}
+	for (std::size_t i{0}; i < band.size(); ++i)
+	{
+		LineShape line{toScreen(band[i]), toScreen(band[(i + 1) % band.size()])};
+		line.draw(highlightColor, surface);
+	}
+}
+
+bool Editor::isDamaged()
+{
+	// The hovered object may have been moved or removed
+	if (game.level.getRevision() != hoveredRevision)
+		updateHover();
+	if (canvasStale || game.level.getRevision() != submittedRevision)
+		submitCanvas();
+	return damaged || renderer.isReady();
+}
+
+bool Editor::isAnimating()
+{
+	return renderer.isBusy();
 }
 
 const Vec2d& Editor::getMouseReal()
@@ -468,6 +1021,23 @@ const Vec2d& Editor::getMouseReal()
 	return mouseReal;
 }
 
+const std::vector<uint16_t>& Editor::getSelection()
+{
+	if (game.level.getRevision() != selectionRevision)
+	{
+		selection.clear();
+		selectionRevision = game.level.getRevision();
+	}
+	return selection;
+}
+
+void Editor::setSelection(std::vector<uint16_t> &&selection)
+{
+	this->selection = std::move(selection);
+	selectionRevision = game.level.getRevision();
+	canvasStale = true;
+}
+
 bool Editor::undo()
 {
 	return history.undo();
@@ -503,6 +1073,7 @@ void Editor::dragTo(int32_t x, int32_t y)
 	// because we actually want to drag the CANVAS not the VIEW
 	view.origin[0] += (xOrigin - x) * view.scale;
 	view.origin[1] += (yOrigin - y) * view.scale;
+	canvasStale = true;
 }
 
 double Editor::zoomView(int32_t zoomInput)
@@ -513,6 +1084,7 @@ double Editor::zoomView(int32_t zoomInput)
 	double zoom{-zoomCoeff * zoomInput * view.scale};
 	zoom = std::clamp(view.scale + zoom, zoomMin, zoomMax) - view.scale;
 	view.origin += (view.origin - mouseReal) / view.scale * zoom;
+	canvasStale = true;
 	return view.scale += zoom;
 }
 
@@ -1,7 +1,11 @@
 #ifndef EDITOR_HPP
 #define EDITOR_HPP
 
+#include <array>
+#include <charconv>
 #include <iostream>
+#include <optional>
+#include "canvas_renderer.hpp"
 #include "game.hpp"
 #include "io.hpp"
 #include "line_shape.hpp"
@@ -11,7 +15,7 @@
  * TODO: Add more tools.
  * TODO: Add in-game preview.
  * TODO: Add the ability to highlight selected objects.
- *       (also need to add more shapes)
+ *       (the vertex or line under the mouse, and the selection are highlighted)
  * NOTE: To differentiate between canvas and preview,
  *       use "editor" or "preview" in names.
  *
@@ -55,6 +59,7 @@
  * q: Quit, always ask confirmation
  * n: New, ask confirmation when level changed
  * o: Open, ask confirmation when level changed
+ * s: Select
  * Move mouse or press mouse button on null tool: Show coordinates
  */
 class Editor final : public Widget
@@ -70,6 +75,64 @@ private:
 		double scale;
 	};
 
+	/*
+	 * The status line shown while no prompt is shown:
+	 * "<tool>: (<x>,<y>) 1:<zoom>[ H-locked| V-locked]"
+	 *
+	 * Each field is formatted into a fixed-capacity buffer with std::to_chars,
+	 * and the line is only composed again when a formatted field actually changed,
+	 * so updating it on every mouse event does not allocate.
+	 */
+	class Status
+	{
+	private:
+		template <std::size_t capacity>
+		class Field
+		{
+		private:
+			std::array<char, capacity> buffer;
+			std::size_t size;
+
+		public:
+			Field();
+			// Return true if the content changed, content is truncated to the capacity
+			bool set(std::string_view content);
+			std::string_view get() const;
+		};
+
+		static constexpr std::size_t numberCapacity{32};
+		static constexpr std::size_t lineCapacity{160};
+		static constexpr int precision{6};
+
+		Field<16> tool;
+		Field<numberCapacity> x;
+		Field<numberCapacity> y;
+		Field<numberCapacity> zoom;
+		Field<16> lock;
+		bool changed;
+
+		Field<lineCapacity> line;
+
+		// Return the formatted number in buffer
+		static std::string_view format(double value, std::array<char, numberCapacity> &buffer);
+		static std::string_view format(std::size_t value, std::array<char, numberCapacity> &buffer);
+
+	public:
+		Status();
+		void setTool(std::string_view name);
+		void setCoordinates(const Vec2d &coord);
+		void setZoom(double scale);
+		void setLock(bool hLocked, bool vLocked);
+
+		// Compose the line if any field changed, and copy it into target if different
+		void show(std::string &target);
+
+		// Format "<prefix><value>" into target without allocating (if target has the capacity)
+		static void assignNumber(std::string &target, std::string_view prefix, double value);
+		// Append a count to target without allocating (if target has the capacity)
+		static void appendCount(std::string &target, std::size_t count);
+	};
+
 	/*
 	 * The current tool is kept similar to a state machine,
 	 * the next tool will be returned through handleEvent().
@@ -123,12 +186,6 @@ private:
 			const std::string& getText();
 		};
 
-		// Distance(proportional to view HEIGHT, in REAL distance on CANVAS) from the object that,
-		// during mouse click, will still count as selecting the object.
-		// Note: Uses view height because view width varies a lot.
-		const double vertexCanvasEps{0.002};
-		const double lineCanvasEps{0.002};
-
 		Editor &editor;
 
 	public:
@@ -165,7 +222,7 @@ private:
 	class NullTool final : public Tool
 	{
 	private:
-		static constexpr std::string_view defaultStatus{"NULL: "};
+		static constexpr std::string_view toolName{"NULL"};
 		static constexpr std::string_view quitPromptStatus{"Are you sure to quit? [y/N]"};
 		static constexpr std::string_view newPromptStatus{"Are you sure to begin a new level? [y/N]"};
 		static constexpr std::string_view newMessage{"New level"};
@@ -200,6 +257,69 @@ private:
 		std::tuple<bool, bool, std::unique_ptr<Tool> > handleEvent(const SDL_Event &event) override;
 	};
 
+	/*
+	 * Select vertices inside a box or lasso, lines are selected when both of their vertices are.
+	 * Removing, moving, or duplicating the selection is a single change to the level and a single operation in history,
+	 * the tool is appended to history to be the operation, and a new one takes its place.
+	 *
+	 * Operations:
+	 * Drag mouse (hold RMB down): Select vertices inside the box or lasso
+	 * b: Select with box
+	 * l: Select with lasso
+	 * a: Select all
+	 * c: Clear selection
+	 * x, DELETE: Remove the selection (and the lines connected to it)
+	 * m: Move the selection, by the offset from the mouse now to the next click
+	 * d: Duplicate the selection, placed by the offset from the mouse now to the next click
+	 */
+	class SelectTool final : public Tool
+	{
+	private:
+		enum Operation
+		{
+			none,
+			remove,
+			move,
+			duplicate
+		};
+
+		static constexpr std::string_view toolName{"SELECT"};
+		static constexpr std::string_view boxName{" (box): "};
+		static constexpr std::string_view lassoName{" (lasso): "};
+		static constexpr std::string_view selectedName{" vertices selected"};
+		static constexpr std::string_view movePromptStatus{"Move: click the destination"};
+		static constexpr std::string_view duplicatePromptStatus{"Duplicate: click the destination"};
+		// Distance(in px) the mouse moves before adding a point to the lasso
+		static constexpr double lassoStep{4.0};
+
+		bool lasso;
+		bool selecting;
+		// The operation waiting for the click, and the mouse when it is started
+		Operation pending;
+		Vec2d anchor;
+
+		// The performed operation
+		Operation operation;
+		std::vector<uint16_t> indices;
+		Vec2d offset;
+		// The vertices removed, and the lines connected to them with their IDs before removal
+		std::vector<Level::Vertex> removedVertices;
+		std::vector<Level::Line> removedLines;
+		// The ID of the first vertex duplicated
+		std::size_t firstDuplicate;
+
+		void showStatus();
+		void select();
+		// Perform operation on the selection, and return the result of handleEvent()
+		std::tuple<bool, bool, std::unique_ptr<Tool> > perform(Operation operation);
+
+	public:
+		SelectTool(Editor &editor, bool lasso = false);
+		std::tuple<bool, bool, std::unique_ptr<Tool> > handleEvent(const SDL_Event &event) override;
+		void activate() override;
+		void undo() override;
+	};
+
 	/*
 	 * Maintains a pointer to a list of operations in order to undo/redo by moving the pointer.
 	 * The current pointer points at one past the last operation.
@@ -226,6 +346,12 @@ private:
 	// Initial view scale
 	const double initScale{0.05};
 
+	// Distance(proportional to view HEIGHT, in REAL distance on CANVAS) from the object that,
+	// during mouse click, will still count as selecting the object.
+	// Note: Uses view height because view width varies a lot.
+	static constexpr double vertexCanvasEps{0.002};
+	static constexpr double lineCanvasEps{0.002};
+
 	ViewRect view;
 
 public:
@@ -242,6 +368,9 @@ public:
 	// Display input to EDITOR itself, messages, and errors
 	std::string &message;
 
+	// Fields of status shown by the default tool
+	Status statusLine;
+
 private:
 	std::unique_ptr<Tool> tool;
 	History history;
@@ -267,9 +396,43 @@ private:
 
 	const sw::Color foregroundColor{255, 255, 255, 255};
 	const sw::Color backgroundColor{0  ,   0,   0, 255};
+	const sw::Color highlightColor {255, 255,   0, 255};
+	const sw::Color selectionColor {0  , 191, 255, 255};
+	// Half of the side of the square drawn over a highlighted vertex, in px
+	const int vertexHighlightSize{3};
+
+	// The level is rasterized on the render thread, and the finished canvas blitted by draw()
+	CanvasRenderer renderer;
+	sw::Surface canvas;
+	// Level::getRevision() when last submitted
+	uint64_t submittedRevision;
+	// The view or dimension changed since last submitted
+	bool canvasStale;
+
+	// The object under the mouse, a vertex takes precedence over the lines ending at it
+	std::optional<uint16_t> hoveredVertex;
+	std::optional<Level::Line> hoveredLine;
+	// Level::getRevision() when the hovered object was last picked
+	uint64_t hoveredRevision;
+
+	// Sorted IDs of the selected vertices, cleared when the level is changed other than by setSelection()
+	std::vector<uint16_t> selection;
+	// Level::getRevision() when the selection was set
+	uint64_t selectionRevision;
+	// The box or lasso being dragged, in real coordinates
+	std::vector<Vec2d> band;
 
 	// Wrapper to deal with tool pointer and history after tool handled event
 	void toolHandleEvent(const SDL_Event &event);
+	// Submit the current view of the level to the renderer
+	void submitCanvas();
+	// Pick the object under the mouse again, and damage the editor if it changed
+	void updateHover();
+	// Screen coordinates on the canvas of a vertex
+	Vec2d toScreen(const Level::Vertex &vertex);
+
+	const std::vector<uint16_t>& getSelection();
+	void setSelection(std::vector<uint16_t> &&selection);
 
 public:
 	// true for change since last new/load/save
@@ -277,8 +440,12 @@ public:
 	const std::function<void()> onExit;
 
 	Editor(const DoubleRect &dimension, Log &logger, sw::Window &window, Game &game, std::string &status, std::string &message, std::function<void()> onExit);
+	void reInit(int wScreen, int hScreen) final;
 	void handleEvent(const SDL_Event &event) final;
+	unsigned getEventMask() final;
 	void draw(sw::Surface &surface) final;
+	bool isDamaged() final;
+	bool isAnimating() final;
 
 	const Vec2d& getMouseReal();
 
@@ -32,6 +32,29 @@ void Font::open(const std::filesystem::path &file, int ptsize, long index)
 	}
 }
 
+void Font::open(const void *data, int size, int ptsize, long index)
+{
+	if (font)
+		throw std::runtime_error{"Font::open() failed: font already open"};
+
+	SDL_RWops *rw{SDL_RWFromConstMem(data, size)};
+	if (!rw)
+	{
+		std::string message{"Font::open() failed: "};
+		message += SDL_GetError();
+		throw std::runtime_error{message};
+	}
+
+	// rw is freed by TTF_OpenFontIndexRW() as freesrc is set
+	font = TTF_OpenFontIndexRW(rw, 1, ptsize, index);
+	if (!font)
+	{
+		std::string message{"Font::open() failed: "};
+		message += TTF_GetError();
+		throw std::runtime_error{message};
+	}
+}
+
 void Font::close()
 {
 	if (!font)
@@ -48,6 +71,7 @@ Font::operator bool()
 
 Surface Font::renderSolid(std::string_view text, const Color &fg)
 {
+	std::lock_guard<std::mutex> lock{mutex};
 	Surface surface{TTF_RenderText_Solid(font, text.data(), fg)};
 	if (!surface)
 	{
@@ -60,6 +84,7 @@ Surface Font::renderSolid(std::string_view text, const Color &fg)
 
 Surface Font::renderShaded(std::string_view text, const ColorPair &color)
 {
+	std::lock_guard<std::mutex> lock{mutex};
 	Surface surface{TTF_RenderText_Shaded(font, text.data(), color.first, color.second)};
 	if (!surface)
 	{
@@ -72,6 +97,7 @@ Surface Font::renderShaded(std::string_view text, const ColorPair &color)
 
 Surface Font::renderBlended(std::string_view text, const Color &fg)
 {
+	std::lock_guard<std::mutex> lock{mutex};
 	Surface surface{TTF_RenderText_Blended(font, text.data(), fg)};
 	if (!surface)
 	{
@@ -82,6 +108,17 @@ Surface Font::renderBlended(std::string_view text, const Color &fg)
 	return surface;
 }
 
+void Font::sizeText(std::string_view text, int *w, int *h)
+{
+	std::lock_guard<std::mutex> lock{mutex};
+	if (TTF_SizeText(font, text.data(), w, h) < 0)
+	{
+		std::string message{"Font::sizeText() failed: "};
+		message += TTF_GetError();
+		throw std::runtime_error{message};
+	}
+}
+
 void Font::setStyle(int style)
 {
 	TTF_SetFontStyle(font, style);
@@ -4,6 +4,7 @@
 #include "surface.hpp"
 #include <SDL_ttf.h>
 #include <filesystem>
+#include <mutex>
 
 namespace sw // Sdl Wrapper
 {
@@ -11,11 +12,15 @@ namespace sw // Sdl Wrapper
 /*
  * A simple wrapper for TTF_Font
  * NOTE: Due to the specification of SDL, const object will be unavailable
+ * NOTE: Rendering is serialized for each font,
+ *       so a font can be shared with worker threads.
+ *       Opening and closing fonts is only done in the main thread.
  */
 class Font
 {
 private:
 	TTF_Font *font;
+	std::mutex mutex;
 
 public:
 	Font();
@@ -24,6 +29,9 @@ public:
 	~Font();
 
 	void open(const std::filesystem::path &file, int ptsize, long index = 0);
+	// Open from a font file already loaded into memory
+	// NOTE: data MUST be kept alive until the font is closed
+	void open(const void *data, int size, int ptsize, long index = 0);
 	void close();
 	operator bool();
 
@@ -32,6 +40,9 @@ public:
 	Surface renderShaded(std::string_view text, const ColorPair &color);
 	Surface renderBlended(std::string_view text, const Color &fg);
 
+	// Get the dimension of the rendered text without actually rendering it
+	void sizeText(std::string_view text, int *w, int *h);
+
 	void setStyle(int style);
 	int getStyle();
 	void setOutline(int outline);
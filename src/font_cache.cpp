@@ -0,0 +1,56 @@
+#include "font_cache.hpp"
+#include "profiler.hpp"
+
+const std::vector<char>& FontCache::loadFile(const std::filesystem::path &file)
+{
+	auto it{files.find(file.string())};
+	if (it != files.end())
+		return it->second;
+
+	SAL_PROFILE("FontCache::loadFile");
+	std::ifstream ifs{file, std::ios::binary | std::ios::ate};
+	if (!ifs)
+		throw std::runtime_error{"FontCache::loadFile() failed: cannot open \"" + file.string() + '\"'};
+
+	std::vector<char> data(static_cast<std::size_t>(ifs.tellg()));
+	ifs.seekg(0, std::ios::beg);
+	if (!ifs.read(data.data(), data.size()))
+		throw std::runtime_error{"FontCache::loadFile() failed: cannot read \"" + file.string() + '\"'};
+
+	WRITE_LOG(logger, Log::info, "FontCache: loaded \"" << file.string() << "\" (" << data.size() << " bytes)" << std::endl);
+	return files.emplace(file.string(), std::move(data)).first->second;
+}
+
+FontCache::FontCache(Log &logger) : logger{logger}
+{
+}
+
+void FontCache::preload(const std::filesystem::path &file)
+{
+	loadFile(file);
+}
+
+FontCache::Handle FontCache::get(const std::filesystem::path &file, int ptsize, long index)
+{
+	Key key{file.string(), ptsize, index};
+	auto it{fonts.find(key)};
+	if (it != fonts.end())
+		return it->second;
+
+	const std::vector<char> &data{loadFile(file)};
+	Handle font{std::make_shared<sw::Font>()};
+	font->open(data.data(), static_cast<int>(data.size()), ptsize, index);
+	fonts.emplace(std::move(key), font);
+	return font;
+}
+
+void FontCache::collect()
+{
+	for (auto it{fonts.begin()}; it != fonts.end(); )
+	{
+		if (it->second.use_count() == 1)
+			it = fonts.erase(it);
+		else
+			++it;
+	}
+}
@@ -0,0 +1,49 @@
+#ifndef FONT_CACHE_HPP
+#define FONT_CACHE_HPP
+
+#include "font.hpp"
+#include "log.hpp"
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <vector>
+
+/*
+ * A process-wide registry of fonts shared by all widgets and states.
+ *
+ * Font files are read into memory only once, and every opened font is kept
+ * for the same (file, point size, face index), so switching states or
+ * reinitializing widgets does not touch the disk again.
+ */
+class FontCache
+{
+public:
+	using Handle = std::shared_ptr<sw::Font>;
+
+private:
+	using Key = std::tuple<std::string, int, long>;
+
+	Log &logger;
+	std::map<std::string, std::vector<char> > files;
+	std::map<Key, Handle> fonts;
+
+	const std::vector<char>& loadFile(const std::filesystem::path &file);
+
+public:
+	FontCache(Log &logger);
+
+	// Read a font file into memory in advance
+	void preload(const std::filesystem::path &file);
+
+	// Return a shared handle to the font, opening it if not yet opened
+	// Throws EXCEPTION if failed.
+	Handle get(const std::filesystem::path &file, int ptsize, long index = 0);
+
+	// Close the fonts that are no longer used by anyone else
+	void collect();
+};
+
+#endif // ifndef FONT_CACHE_HPP
@@ -0,0 +1,56 @@
+#include "frame_scheduler.hpp"
+#include <thread>
+
+void FrameScheduler::sleepUntil(clock_t::time_point time)
+{
+	auto remaining{time - clock_t::now()};
+	if (remaining > spinThreshold)
+		std::this_thread::sleep_for(remaining - spinThreshold);
+
+	while (clock_t::now() < time)
+	{
+	}
+}
+
+FrameScheduler::FrameScheduler(Log &logger, const Settings &settings, sw::Window &window)
+	: logger{logger}, mode{settings.frameMode.get() == "uncapped" ? uncapped : paced},
+	  idleWait{settings.frameIdle}, idleTimeout{settings.frameIdleTimeout}, deadline{clock_t::now()}
+{
+	int rate{settings.frameRate.get()};
+	if (rate == 0)
+	{
+		SDL_DisplayMode displayMode;
+		if (SDL_GetWindowDisplayMode(window.getPtr(), &displayMode) == 0 && displayMode.refresh_rate > 0)
+			rate = displayMode.refresh_rate;
+		else
+			rate = 60;
+	}
+	period = std::chrono::duration_cast<clock_t::duration>(std::chrono::duration<double>{1.0 / rate});
+
+	WRITE_LOG(logger, Log::info, "FrameScheduler: " << (mode == paced ? "paced" : "uncapped")
+	       << " at " << rate << " Hz, idle wait " << (idleWait.get() ? "on" : "off") << std::endl);
+}
+
+bool FrameScheduler::waitIdle(bool idle, SDL_Event &event)
+{
+	if (!idle || !idleWait.get())
+		return false;
+
+	bool received{SDL_WaitEventTimeout(&event, idleTimeout.get()) != 0};
+	// Respond to the event immediately instead of waiting for the old deadline
+	deadline = clock_t::now();
+	return received;
+}
+
+void FrameScheduler::pace()
+{
+	if (mode == uncapped)
+		return;
+
+	deadline += period;
+	auto now{clock_t::now()};
+	// Too late to catch up, start over from now instead of running frames back to back
+	if (deadline < now)
+		deadline = now + period;
+	sleepUntil(deadline);
+}
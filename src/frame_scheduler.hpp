@@ -0,0 +1,57 @@
+#ifndef FRAME_SCHEDULER_HPP
+#define FRAME_SCHEDULER_HPP
+
+#include "log.hpp"
+#include "settings.hpp"
+#include "window.hpp"
+#include <SDL.h>
+#include <chrono>
+
+/*
+ * Decides when the main loop runs the next frame.
+ *
+ * Modes (config "frame.mode"):
+ * paced:    frames are paced to "frame.rate" (default: refresh rate of the display),
+ *           by sleeping until shortly before the deadline, then spinning until it,
+ *           so that frames start within a fraction of a millisecond of their deadline.
+ * uncapped: frames run as fast as possible, for benchmarking.
+ *
+ * Unless "frame.idle" is 0, the main loop blocks in SDL_WaitEventTimeout()
+ * while nothing on screen is changing, instead of running empty frames.
+ */
+class FrameScheduler
+{
+public:
+	enum Mode
+	{
+		paced,
+		uncapped
+	};
+
+private:
+	using clock_t = std::chrono::steady_clock;
+
+	// Sleeping is only precise to about this, the rest is spent spinning
+	static constexpr std::chrono::microseconds spinThreshold{2000};
+
+	Log &logger;
+	Mode mode;
+	Config::Handle<bool> idleWait;
+	Config::Handle<int> idleTimeout; // ms, only a safety net as nothing should change without events
+	clock_t::duration period;
+	clock_t::time_point deadline;
+
+	void sleepUntil(clock_t::time_point time);
+
+public:
+	FrameScheduler(Log &logger, const Settings &settings, sw::Window &window);
+
+	// Block until an event arrives if idle (and idle waiting is enabled),
+	// return true if an event has been stored in event.
+	bool waitIdle(bool idle, SDL_Event &event);
+
+	// Called at the end of each frame, wait until the next frame should start
+	void pace();
+};
+
+#endif // ifndef FRAME_SCHEDULER_HPP
@@ -1,4 +1,13 @@
 #include "io.hpp"
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SALTFISH_SSE2
+#include <emmintrin.h>
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
 
 void serial(uint16_t value, std::vector<std::byte> &buffer)
 {
@@ -123,83 +132,206 @@ void deserial(double &value, std::vector<std::byte> &buffer, std::size_t &index)
 	memcpy(&value, &ivalue, sizeof(value));
 }
 
-Tokens tokenize(std::string_view data)
+namespace
 {
-	static const std::array<char, 1> operators{'='};
+	// Classes of characters for the tokenizer, as bits
+	enum CharClass : unsigned char
+	{
+		spaceClass     = 1, // as std::isspace() in the "C" locale
+		quoteClass     = 2,
+		backslashClass = 4,
+		operatorClass  = 8  // a token on its own
+	};
+
+	constexpr std::array<char, 1> operators{'='};
+
+	constexpr std::array<unsigned char, 256> makeCharClasses()
+	{
+		std::array<unsigned char, 256> classes{};
+		for (unsigned char space : {' ', '\t', '\n', '\v', '\f', '\r'})
+			classes[space] |= spaceClass;
+		classes[static_cast<unsigned char>('\"')] |= quoteClass;
+		classes[static_cast<unsigned char>('\\')] |= backslashClass;
+		for (char element : operators)
+			classes[static_cast<unsigned char>(element)] |= operatorClass;
+		return classes;
+	}
+
+	constexpr std::array<unsigned char, 256> charClasses{makeCharClasses()};
 
-	Tokens out;
-	bool quoted{false};
-	bool escape{false};
-	bool next{true};
-	for (char current : data)
+#ifdef SALTFISH_SSE2
+	int countTrailingZeros(std::uint64_t mask)
 	{
-		if (quoted)
+#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanForward64(&index, mask);
+		return static_cast<int>(index);
+#else
+		return __builtin_ctzll(mask);
+#endif
+	}
+#endif
+
+	/*
+	 * Finds characters by their classes,
+	 * with SSE2, 64 characters are classified at a time into bit masks, so each character is only classified once,
+	 * otherwise the characters are looked up in charClasses one by one
+	 */
+	class Scanner
+	{
+	private:
+		std::string_view data;
+
+#ifdef SALTFISH_SSE2
+		static constexpr std::size_t blockSize{64};
+		static constexpr std::size_t probeSize{16};
+
+		std::size_t blockBegin;
+		std::array<std::uint64_t, 4> masks; // one for each class, bit i is character blockBegin + i
+
+		void load(std::size_t begin)
 		{
-			if (!escape && current == '\"')
+			blockBegin = begin;
+			const char *block{data.data() + begin};
+			// The end is padded with characters of no class
+			std::array<char, blockSize> padded{};
+			if (begin + blockSize > data.size())
 			{
-				quoted = false;
-				escape = false;
-				next = true;
+				std::memcpy(padded.data(), block, data.size() - begin);
+				block = padded.data();
 			}
-			else if (!escape && current == '\\')
+
+			masks = {};
+			const __m128i spaceLow{_mm_set1_epi8('\t' - 1)};
+			const __m128i spaceHigh{_mm_set1_epi8('\r' + 1)};
+			for (std::size_t i{0}; i < blockSize; i += 16)
 			{
-				escape = true;
+				__m128i chunk{_mm_loadu_si128(reinterpret_cast<const __m128i*>(block + i))};
+				// '\t' to '\r' are contiguous
+				__m128i space{_mm_and_si128(_mm_cmpgt_epi8(chunk, spaceLow), _mm_cmplt_epi8(chunk, spaceHigh))};
+				space = _mm_or_si128(space, _mm_cmpeq_epi8(chunk, _mm_set1_epi8(' ')));
+				__m128i op{_mm_setzero_si128()};
+				for (char element : operators)
+					op = _mm_or_si128(op, _mm_cmpeq_epi8(chunk, _mm_set1_epi8(element)));
+
+				masks[0] |= static_cast<std::uint64_t>(_mm_movemask_epi8(space)) << i;
+				masks[1] |= static_cast<std::uint64_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('\"')))) << i;
+				masks[2] |= static_cast<std::uint64_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('\\')))) << i;
+				masks[3] |= static_cast<std::uint64_t>(_mm_movemask_epi8(op)) << i;
 			}
-			else if (next)
+		}
+#endif
+
+	public:
+#ifdef SALTFISH_SSE2
+		explicit Scanner(std::string_view data) : data{data}, blockBegin{std::string_view::npos}
+		{
+		}
+#else
+		explicit Scanner(std::string_view data) : data{data}
+		{
+		}
+#endif
+
+		/*
+		 * Position of the first character from pos that is in any of classes (or in none if match is false),
+		 * or data.size() if there is none
+		 */
+		std::size_t scan(std::size_t pos, unsigned classes, bool match)
+		{
+#ifdef SALTFISH_SSE2
+			// Most tokens and gaps are short, so a few characters are checked one by one first
+			for (std::size_t probeEnd{std::min(pos + probeSize, data.size())}; pos < probeEnd; ++pos)
 			{
-				out.push_back({current});
-				next = false;
+				if (((charClasses[static_cast<unsigned char>(data[pos])] & classes) != 0) == match)
+					return pos;
 			}
-			else
+
+			while (pos < data.size())
 			{
-				out.back().push_back(current);
-				escape = false;
+				std::size_t begin{pos - pos % blockSize};
+				if (begin != blockBegin)
+					load(begin);
+
+				std::uint64_t mask{0};
+				for (std::size_t bit{0}; bit < masks.size(); ++bit)
+					mask |= masks[bit] & (std::uint64_t{0} - ((classes >> bit) & 1));
+				if (!match)
+					mask = ~mask;
+				mask &= ~std::uint64_t{0} << (pos - begin);
+
+				if (mask != 0)
+					return std::min(begin + static_cast<std::size_t>(countTrailingZeros(mask)), data.size());
+				pos = begin + blockSize;
+			}
+#else
+			for (; pos < data.size(); ++pos)
+			{
+				if (((charClasses[static_cast<unsigned char>(data[pos])] & classes) != 0) == match)
+					return pos;
 			}
+#endif
+			return data.size();
 		}
-		else
+	};
+}
+
+void tokenize(std::string_view data, Tokens &tokens)
+{
+	tokens.tokens.clear();
+	tokens.unescaped.clear();
+	tokens.unescaped.reserve(data.size());
+
+	Scanner scanner{data};
+	std::size_t pos{0};
+	while (true)
+	{
+		pos = scanner.scan(pos, spaceClass, false);
+		if (pos == data.size())
+			break;
+
+		unsigned classes{charClasses[static_cast<unsigned char>(data[pos])]};
+		if (classes & operatorClass)
+		{
+			tokens.tokens.push_back(data.substr(pos, 1));
+			++pos;
+		}
+		else if (classes & quoteClass)
 		{
-			if (std::isspace(current))
+			std::size_t begin{pos + 1};
+			std::size_t end{scanner.scan(begin, quoteClass | backslashClass, true)};
+			if (end == data.size() || data[end] == '\"')
 			{
-				next = true;
+				// No escape, an unterminated string ends with data
+				tokens.tokens.push_back(data.substr(begin, end - begin));
+				pos = std::min(end + 1, data.size());
+				continue;
 			}
-			else
+
+			std::size_t unescapedBegin{tokens.unescaped.size()};
+			pos = begin;
+			while (true)
 			{
-				bool isOperator{false};
-				for (char element : operators)
+				end = scanner.scan(pos, quoteClass | backslashClass, true);
+				tokens.unescaped.append(data.substr(pos, end - pos));
+				if (end == data.size() || data[end] == '\"')
 				{
-					if (current == element)
-					{
-						isOperator = true;
-						break;
-					}
+					pos = std::min(end + 1, data.size());
+					break;
 				}
 
-				if (isOperator)
-				{
-					out.push_back({current});
-					next = true;
-				}
-				else
-				{
-					if (current == '\"')
-					{
-						quoted = true;
-						next = true;
-					}
-					else if (next)
-					{
-						out.push_back({current});
-						next = false;
-					}
-					else
-					{
-						out.back().push_back(current);
-					}
-				}
+				// The character after a backslash is taken as is
+				if (end + 1 < data.size())
+					tokens.unescaped.push_back(data[end + 1]);
+				pos = std::min(end + 2, data.size());
 			}
+			tokens.tokens.push_back(std::string_view{tokens.unescaped}.substr(unescapedBegin));
+		}
+		else
+		{
+			std::size_t end{scanner.scan(pos, spaceClass | quoteClass | operatorClass, true)};
+			tokens.tokens.push_back(data.substr(pos, end - pos));
+			pos = end;
 		}
 	}
-
-	return out;
 }
-
@@ -9,10 +9,11 @@
 #define IO_HPP
 
 #include <array>
-#include <list>
+#include <charconv>
 #include <string>
 #include <string_view>
 #include <sstream>
+#include <type_traits>
 #include <vector>
 #include <stdexcept>
 #include <cstddef>
@@ -39,41 +40,104 @@ void deserial(uint64_t &value, std::vector<std::byte> &buffer, std::size_t &inde
 void deserial(int64_t &value, std::vector<std::byte> &buffer, std::size_t &index);
 void deserial(double &value, std::vector<std::byte> &buffer, std::size_t &index);
 
-using Tokens = std::list<std::string>;
+/*
+ * Tokens of a string, see tokenize()
+ * NOTE: Tokens are views into the tokenized string,
+ *       except double-quoted tokens with escapes, which are copied into the Tokens,
+ *       so they are only valid as long as both.
+ *       Reuse a Tokens for many strings, and no memory is allocated once it is large enough.
+ */
+class Tokens
+{
+private:
+	friend void tokenize(std::string_view data, Tokens &tokens);
+
+	std::vector<std::string_view> tokens;
+	// Reserved to the size of the string, so views into it stay valid
+	std::string unescaped;
+
+public:
+	using const_iterator = std::vector<std::string_view>::const_iterator;
+
+	const_iterator begin() const
+	{
+		return tokens.begin();
+	}
+
+	const_iterator end() const
+	{
+		return tokens.end();
+	}
+
+	std::size_t size() const
+	{
+		return tokens.size();
+	}
+
+	bool empty() const
+	{
+		return tokens.empty();
+	}
+
+	std::string_view operator[](std::size_t index) const
+	{
+		return tokens[index];
+	}
+};
 
 /*
- * convert a space-seperated string into tokens
+ * convert a space-seperated string into tokens, replacing the content of tokens
  * NOTE: Each "Operator" is one token, and double-quoted "" part count as one token (a string).
  *       Backslash "\" can be used for escaping inside a double-quoted token.
  */
-Tokens tokenize(std::string_view data);
+void tokenize(std::string_view data, Tokens &tokens);
+
+/*
+ * convert one token to a variable
+ */
+template<typename T>
+void convertToken(std::string_view token, T &value)
+{
+	if constexpr (std::is_same_v<T, std::string>)
+	{
+		value.assign(token);
+	}
+	else if constexpr (std::is_arithmetic_v<T> && !std::is_same_v<T, bool>)
+	{
+		if (!token.empty() && token.front() == '+')
+			token.remove_prefix(1);
+		auto [end, error]{std::from_chars(token.data(), token.data() + token.size(), value)};
+		if (error != std::errc{} || end != token.data() + token.size())
+			throw std::runtime_error{"convertTokens() failed: token type conversion failed"};
+	}
+	else
+	{
+		std::stringstream stream{std::string{token}};
+		stream >> value;
+		if (stream.fail())
+			throw std::runtime_error{"convertTokens() failed: token type conversion failed"};
+	}
+}
 
 /*
  * convert tokens to various number of variables in various types
  */
 template<typename T>
-void convertTokens(Tokens::iterator begin, Tokens::iterator end, T &current)
+void convertTokens(Tokens::const_iterator begin, Tokens::const_iterator end, T &current)
 {
 	if (begin == end)
 		throw std::runtime_error{"convertTokens() failed: wrong number of tokens"};
 
-	std::stringstream stream{*begin};
-	stream >> current;
-	if (stream.fail())
-		throw std::runtime_error{"convertTokens() failed: token type conversion failed"};
+	convertToken(*begin, current);
 }
 
 template<typename T, typename ...Args>
-void convertTokens(Tokens::iterator begin, Tokens::iterator end, T &current, Args&... rest)
+void convertTokens(Tokens::const_iterator begin, Tokens::const_iterator end, T &current, Args&... rest)
 {
 	if (begin == end)
 		throw std::runtime_error{"convertTokens() failed: wrong number of tokens"};
 
-	std::stringstream stream{*begin};
-	stream >> current;
-	if (stream.fail())
-		throw std::runtime_error{"convertTokens() failed: token type conversion failed"};
-
+	convertToken(*begin, current);
 	convertTokens(++begin, end, rest...);
 }
 
@@ -0,0 +1,204 @@
+#include "kd_tree.hpp"
+#include <cmath>
+
+KdTree::Box KdTree::Box::around(const Vec2d &p0, const Vec2d &p1)
+{
+	return {{std::min(p0[0], p1[0]), std::min(p0[1], p1[1])},
+	        {std::max(p0[0], p1[0]), std::max(p0[1], p1[1])}};
+}
+
+double KdTree::Box::distanceSquared(const Vec2d &point) const
+{
+	double dx{std::max({min[0] - point[0], 0.0, point[0] - max[0]})};
+	double dy{std::max({min[1] - point[1], 0.0, point[1] - max[1]})};
+	return dx * dx + dy * dy;
+}
+
+bool KdTree::Box::intersects(const Box &box) const
+{
+	return    min[0] <= box.max[0] && box.min[0] <= max[0]
+	       && min[1] <= box.max[1] && box.min[1] <= max[1];
+}
+
+void KdTree::Box::extend(const Box &box)
+{
+	min = {std::min(min[0], box.min[0]), std::min(min[1], box.min[1])};
+	max = {std::max(max[0], box.max[0]), std::max(max[1], box.max[1])};
+}
+
+double KdTree::center(const Box &box, int axis)
+{
+	return (box.min[axis] + box.max[axis]) / 2.0;
+}
+
+uint32_t KdTree::getCount(int32_t index) const
+{
+	return index == none ? 0 : nodes[index].count;
+}
+
+int32_t KdTree::build(std::vector<int32_t>::iterator begin, std::vector<int32_t>::iterator end, int axis,
+                      const std::vector<Node> &source, std::vector<int32_t>::const_iterator &slot)
+{
+	if (begin == end)
+		return none;
+
+	auto middle{begin + (end - begin) / 2};
+	std::nth_element(begin, middle, end,
+	                 [&source, axis](int32_t a, int32_t b)
+	                 {
+	                 	return center(source[a].box, axis) < center(source[b].box, axis);
+	                 });
+
+	int32_t index{*slot++};
+	const Node &item{source[*middle]};
+	nodes[index] = {item.item, item.box, item.box, none, none, static_cast<uint32_t>(end - begin), item.erased};
+	if (!item.erased)
+		nodeOf[item.item] = index;
+
+	int32_t left{build(begin, middle, 1 - axis, source, slot)};
+	int32_t right{build(middle + 1, end, 1 - axis, source, slot)};
+	Node &node{nodes[index]};
+	node.left = left;
+	node.right = right;
+	if (left != none)
+		node.bounds.extend(nodes[left].bounds);
+	if (right != none)
+		node.bounds.extend(nodes[right].bounds);
+	return index;
+}
+
+void KdTree::rebuild()
+{
+	std::vector<Node> source;
+	source.reserve(nodes.size() - erasedCount);
+	for (const Node &node : nodes)
+	{
+		if (!node.erased)
+			source.push_back(node);
+	}
+
+	std::vector<int32_t> order(source.size());
+	for (std::size_t i{0}; i < order.size(); ++i)
+		order[i] = static_cast<int32_t>(i);
+
+	nodes.resize(source.size());
+	nodeOf.clear();
+	erasedCount = 0;
+	// Nodes are laid out in preorder
+	std::vector<int32_t> slots{order};
+	std::vector<int32_t>::const_iterator slot{slots.begin()};
+	root = build(order.begin(), order.end(), 0, source, slot);
+}
+
+void KdTree::rebuild(int32_t index, int axis)
+{
+	// The nodes are reused, starting from index so the parent still points to the subtree
+	std::vector<int32_t> slots{index};
+	std::vector<Node> source;
+	for (std::size_t i{0}; i < slots.size(); ++i)
+	{
+		const Node &node{nodes[slots[i]]};
+		source.push_back(node);
+		if (node.left != none)
+			slots.push_back(node.left);
+		if (node.right != none)
+			slots.push_back(node.right);
+	}
+
+	std::vector<int32_t> order(source.size());
+	for (std::size_t i{0}; i < order.size(); ++i)
+		order[i] = static_cast<int32_t>(i);
+
+	std::vector<int32_t>::const_iterator slot{slots.begin()};
+	build(order.begin(), order.end(), axis, source, slot);
+}
+
+KdTree::KdTree() : root{none}, erasedCount{0}
+{
+}
+
+void KdTree::clear()
+{
+	nodes.clear();
+	nodeOf.clear();
+	root = none;
+	erasedCount = 0;
+}
+
+std::size_t KdTree::size() const
+{
+	return nodes.size() - erasedCount;
+}
+
+void KdTree::build(const std::vector<std::pair<uint32_t, Box> > &items)
+{
+	clear();
+	nodes.reserve(items.size());
+	for (const auto &[item, box] : items)
+		nodes.push_back({item, box, box, none, none, 1, false});
+	rebuild();
+}
+
+void KdTree::insert(uint32_t item, const Box &box)
+{
+	erase(item);
+
+	int32_t index{static_cast<int32_t>(nodes.size())};
+	nodes.push_back({item, box, box, none, none, 1, false});
+	nodeOf[item] = index;
+	if (root == none)
+	{
+		root = index;
+		return;
+	}
+
+	// Items inserted in order (e.g. along a line) would make a list
+	std::size_t limit{std::min(2 * static_cast<std::size_t>(std::log2(nodes.size())) + 8, maxDepth)};
+	std::array<int32_t, maxDepth + 2> path;
+	std::size_t depth{0};
+	int32_t current{root};
+	int axis{0};
+	while (true)
+	{
+		path[depth++] = current;
+		Node &node{nodes[current]};
+		node.bounds.extend(box);
+		++node.count;
+		int32_t &child{center(box, axis) < center(node.box, axis) ? node.left : node.right};
+		if (child == none)
+		{
+			child = index;
+			break;
+		}
+		current = child;
+		axis = 1 - axis;
+	}
+
+	if (depth + 1 <= limit)
+		return;
+
+	for (std::size_t i{depth}; i-- > 0;)
+	{
+		const Node &node{nodes[path[i]]};
+		if (std::max(getCount(node.left), getCount(node.right)) > balance * node.count)
+		{
+			rebuild(path[i], static_cast<int>(i % 2));
+			return;
+		}
+	}
+	rebuild();
+}
+
+bool KdTree::erase(uint32_t item)
+{
+	auto found{nodeOf.find(item)};
+	if (found == nodeOf.end())
+		return false;
+
+	nodes[found->second].erased = true;
+	nodeOf.erase(found);
+	++erasedCount;
+	if (erasedCount > nodes.size() / 2)
+		rebuild();
+	return true;
+}
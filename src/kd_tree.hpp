@@ -0,0 +1,158 @@
+#ifndef KD_TREE_HPP
+#define KD_TREE_HPP
+
+#include "vec.hpp"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/*
+ * A 2D k-d tree of items with bounding boxes, for finding the item nearest to a point,
+ * items are split by the centers of their boxes,
+ * and each node keeps the bounds of its subtree, so items with an extent (e.g. lines) can be stored.
+ *
+ * Items can be inserted and erased one by one, erased items are only marked.
+ * When an insertion makes the tree too deep, the smallest unbalanced subtree on its path is rebuilt (as in a scapegoat tree),
+ * and the whole tree is rebuilt when most nodes are erased.
+ */
+class KdTree
+{
+public:
+	struct Box
+	{
+		Vec2d min;
+		Vec2d max;
+
+		static Box around(const Vec2d &p0, const Vec2d &p1);
+		// Distance from point to the box, 0 if inside
+		double distanceSquared(const Vec2d &point) const;
+		bool intersects(const Box &box) const;
+		void extend(const Box &box);
+	};
+
+private:
+	static constexpr int32_t none{-1};
+	// Of a tree with 2^32 nodes, see insert()
+	static constexpr std::size_t maxDepth{2 * 32 + 8};
+	// A subtree is unbalanced when a child has more than this fraction of its nodes,
+	// an insertion deeper than log(n) / log(1 / balance) passes by an unbalanced subtree
+	static constexpr double balance{0.7};
+
+	struct Node
+	{
+		uint32_t item;
+		Box box;
+		Box bounds; // of the subtree
+		int32_t left;
+		int32_t right;
+		uint32_t count; // of nodes in the subtree, including erased ones
+		bool erased;
+	};
+
+	std::vector<Node> nodes;
+	int32_t root;
+	std::unordered_map<uint32_t, int32_t> nodeOf;
+	std::size_t erasedCount;
+
+	static double center(const Box &box, int axis);
+	uint32_t getCount(int32_t index) const;
+	// Build a balanced tree of source[begin, end) into nodes at slots, in preorder
+	int32_t build(std::vector<int32_t>::iterator begin, std::vector<int32_t>::iterator end, int axis,
+	              const std::vector<Node> &source, std::vector<int32_t>::const_iterator &slot);
+	// Rebuild the whole tree without erased nodes
+	void rebuild();
+	// Rebuild the subtree at index in place, with its root splitting on axis
+	void rebuild(int32_t index, int axis);
+
+public:
+	KdTree();
+
+	void clear();
+	std::size_t size() const;
+	// Replace the content with items, faster than inserting them one by one
+	void build(const std::vector<std::pair<uint32_t, Box> > &items);
+	// An item already in the tree is replaced
+	void insert(uint32_t item, const Box &box);
+	// Return false if item is not in the tree
+	bool erase(uint32_t item);
+
+	/*
+	 * The item nearest to point with distanceSquared(item) <= eps * eps, or none,
+	 * distanceSquared(item) should be at least the distance to the box of the item
+	 */
+	template <typename Distance>
+	std::optional<uint32_t> nearest(const Vec2d &point, double eps, Distance distanceSquared) const
+	{
+		std::optional<uint32_t> best;
+		double bestDistance{eps * eps};
+		if (root == none)
+			return best;
+
+		// Depth is bounded by insert(), and the stack holds at most one sibling for each level
+		std::array<int32_t, maxDepth + 2> stack;
+		std::size_t stackSize{0};
+		stack[stackSize++] = root;
+		while (stackSize > 0)
+		{
+			const Node &node{nodes[stack[--stackSize]]};
+			if (node.bounds.distanceSquared(point) > bestDistance)
+				continue;
+
+			if (!node.erased && node.box.distanceSquared(point) <= bestDistance)
+			{
+				double distance{distanceSquared(node.item)};
+				if (distance <= bestDistance)
+				{
+					bestDistance = distance;
+					best = node.item;
+				}
+			}
+
+			// The nearer child is visited first, as it is pushed last
+			int32_t first{node.left};
+			int32_t second{node.right};
+			if (   first != none && second != none
+			    && nodes[first].bounds.distanceSquared(point) < nodes[second].bounds.distanceSquared(point))
+			{
+				std::swap(first, second);
+			}
+			if (first != none)
+				stack[stackSize++] = first;
+			if (second != none)
+				stack[stackSize++] = second;
+		}
+		return best;
+	}
+
+	// Call visit(item) for each item whose box intersects box, in no particular order
+	template <typename Visit>
+	void query(const Box &box, Visit visit) const
+	{
+		if (root == none)
+			return;
+
+		std::array<int32_t, maxDepth + 2> stack;
+		std::size_t stackSize{0};
+		stack[stackSize++] = root;
+		while (stackSize > 0)
+		{
+			const Node &node{nodes[stack[--stackSize]]};
+			if (!node.bounds.intersects(box))
+				continue;
+
+			if (!node.erased && node.box.intersects(box))
+				visit(node.item);
+			if (node.left != none)
+				stack[stackSize++] = node.left;
+			if (node.right != none)
+				stack[stackSize++] = node.right;
+		}
+	}
+};
+
+#endif // ifndef KD_TREE_HPP
@@ -0,0 +1,179 @@
+#include "latency.hpp"
+#include "canvas_renderer.hpp"
+#include <algorithm>
+#include <iomanip>
+
+LatencyTracker::Histogram::Histogram() : buckets{}, count{0}
+{
+}
+
+void LatencyTracker::Histogram::add(double ms)
+{
+	std::size_t index{ms <= 0.0 ? 0 : static_cast<std::size_t>(ms / bucketWidth)};
+	++buckets[std::min(index, buckets.size() - 1)];
+	++count;
+}
+
+double LatencyTracker::Histogram::percentile(double p) const
+{
+	if (count == 0)
+		return 0.0;
+
+	std::uint64_t target{static_cast<std::uint64_t>(p * count)};
+	std::uint64_t seen{0};
+	for (std::size_t i{0}; i < buckets.size(); ++i)
+	{
+		seen += buckets[i];
+		if (seen > target)
+			return (i + 1) * bucketWidth;
+	}
+	return buckets.size() * bucketWidth;
+}
+
+std::uint64_t LatencyTracker::Histogram::getCount() const
+{
+	return count;
+}
+
+void LatencyTracker::Histogram::clear()
+{
+	buckets.fill(0);
+	count = 0;
+}
+
+std::string_view LatencyTracker::typeName(Uint32 type)
+{
+	switch (type)
+	{
+	case SDL_KEYDOWN:
+		return "key down";
+	case SDL_KEYUP:
+		return "key up";
+	case SDL_TEXTINPUT:
+		return "text input";
+	case SDL_MOUSEMOTION:
+		return "mouse motion";
+	case SDL_MOUSEBUTTONDOWN:
+		return "button down";
+	case SDL_MOUSEBUTTONUP:
+		return "button up";
+	case SDL_MOUSEWHEEL:
+		return "mouse wheel";
+	default:
+		return {};
+	}
+}
+
+void LatencyTracker::summarize(const std::map<std::string_view, Histogram> &histograms, std::vector<Summary> &summaries)
+{
+	for (const auto &[name, histogram] : histograms)
+	{
+		if (histogram.getCount() == 0)
+			continue;
+		summaries.push_back({name,
+		                     histogram.getCount(),
+		                     histogram.percentile(0.50),
+		                     histogram.percentile(0.95),
+		                     histogram.percentile(0.99)});
+	}
+}
+
+void LatencyTracker::report()
+{
+	if (completed == 0)
+		return;
+
+	WRITE_LOG(logger, Log::info, "Latency of the last " << completed << " events: queued "
+	       << std::fixed << std::setprecision(2) << queuedTotal / completed << " ms, handling and drawing "
+	       << drawTotal / completed << " ms, presenting " << presentTotal / completed << " ms on average" << std::endl);
+	for (const Summary &summary : getSummaries())
+	{
+		WRITE_LOG(logger, Log::info, "Latency since start, " << summary.name << ": n=" << summary.count
+		       << std::fixed << std::setprecision(1)
+		       << " p50=" << summary.p50 << " p95=" << summary.p95 << " p99=" << summary.p99 << " ms" << std::endl);
+	}
+
+	queuedTotal = 0.0;
+	drawTotal = 0.0;
+	presentTotal = 0.0;
+	completed = 0;
+}
+
+LatencyTracker::LatencyTracker(Log &logger)
+	: logger{logger}, queuedTotal{0.0}, drawTotal{0.0}, presentTotal{0.0}, completed{0}, lastReport{Profiler::now()}
+{
+}
+
+void LatencyTracker::handled(const SDL_Event &event, std::string_view state)
+{
+	std::string_view type{typeName(event.type)};
+	if (type.empty())
+		return;
+
+	// Timestamps of SDL events are only in ms
+	double queued{static_cast<double>(SDL_GetTicks() - event.common.timestamp)};
+	pending.push_back({type, state, queued, Profiler::now(), 0, CanvasRenderer::getSubmitted()});
+}
+
+void LatencyTracker::drawn()
+{
+	Profiler::tick_t time{Profiler::now()};
+	std::uint64_t submitted{CanvasRenderer::getSubmitted()};
+	for (Pending &event : pending)
+	{
+		if (event.drawn == 0)
+		{
+			event.drawn = time;
+			event.canvasFrame = submitted > event.canvasFrame ? submitted : 0;
+		}
+	}
+}
+
+void LatencyTracker::presented(bool presented)
+{
+	static constexpr double toMs{1e-6};
+
+	Profiler::tick_t time{Profiler::now()};
+	std::uint64_t shown{CanvasRenderer::getShown()};
+	std::size_t kept{0};
+	for (const Pending &event : pending)
+	{
+		// An event handled after drawing is not in this frame
+		bool awaiting{event.drawn == 0 || (event.canvasFrame != 0 && shown < event.canvasFrame)};
+		if (time - event.handled > maxPending)
+			continue;
+		if (awaiting || (!presented && event.canvasFrame != 0))
+		{
+			pending[kept++] = event;
+			continue;
+		}
+		if (!presented)
+			continue;
+
+		double draw{(event.drawn - event.handled) * toMs};
+		double present{(time - event.drawn) * toMs};
+		double total{event.queued + draw + present};
+		byType[event.type].add(total);
+		byState[event.state].add(total);
+
+		queuedTotal += event.queued;
+		drawTotal += draw;
+		presentTotal += present;
+		++completed;
+	}
+	pending.resize(kept);
+
+	if (time - lastReport >= reportInterval)
+	{
+		report();
+		lastReport = time;
+	}
+}
+
+std::vector<LatencyTracker::Summary> LatencyTracker::getSummaries() const
+{
+	std::vector<Summary> summaries;
+	summarize(byType, summaries);
+	summarize(byState, summaries);
+	return summaries;
+}
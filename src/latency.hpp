@@ -0,0 +1,102 @@
+#ifndef LATENCY_HPP
+#define LATENCY_HPP
+
+#include "log.hpp"
+#include "profiler.hpp"
+#include <SDL.h>
+#include <array>
+#include <cstdint>
+#include <map>
+#include <string_view>
+#include <vector>
+
+/*
+ * Measures input-to-photon latency:
+ * from the timestamp of an input event, through Program::handleEvent() and drawing,
+ * to the window surface update presenting the frame.
+ *
+ * An event is complete when the first frame drawn after it is presented,
+ * or, if a canvas frame was submitted to CanvasRenderer while handling and drawing it,
+ * when a frame showing that canvas frame (or a later one) is presented.
+ * If a frame presents nothing and no canvas frame is awaited,
+ * the events drawn in it had no visible effect, and are not counted.
+ * Events still waiting after maxPending are dropped.
+ *
+ * Histograms are kept per event type and per ProgramState,
+ * reported through Log every reportInterval, and shown by ProfileOverlay.
+ */
+class LatencyTracker
+{
+public:
+	// Latencies from 0 to 100ms in steps of 0.1ms, larger ones in the last bucket
+	class Histogram
+	{
+	private:
+		static constexpr double bucketWidth{0.1}; // ms
+		std::array<std::uint32_t, 1001> buckets;
+		std::uint64_t count;
+
+	public:
+		Histogram();
+		void add(double ms);
+		// The latency below which a fraction p of the samples are
+		double percentile(double p) const;
+		std::uint64_t getCount() const;
+		void clear();
+	};
+
+	struct Summary
+	{
+		std::string_view name;
+		std::uint64_t count;
+		double p50;
+		double p95;
+		double p99;
+	};
+
+private:
+	static constexpr Profiler::tick_t reportInterval{10'000'000'000};
+	static constexpr Profiler::tick_t maxPending{1'000'000'000};
+
+	struct Pending
+	{
+		std::string_view type;
+		std::string_view state;
+		double queued; // ms between the event timestamp and handling
+		Profiler::tick_t handled;
+		Profiler::tick_t drawn;
+		// CanvasRenderer::getSubmitted() when handled, then the canvas frame awaited (0 for none) when drawn
+		std::uint64_t canvasFrame;
+	};
+
+	Log &logger;
+	std::vector<Pending> pending;
+	std::map<std::string_view, Histogram> byType;
+	std::map<std::string_view, Histogram> byState;
+
+	// Stage averages since the last report, in ms
+	double queuedTotal;
+	double drawTotal;
+	double presentTotal;
+	std::uint64_t completed;
+	Profiler::tick_t lastReport;
+
+	static std::string_view typeName(Uint32 type);
+	static void summarize(const std::map<std::string_view, Histogram> &histograms, std::vector<Summary> &summaries);
+	void report();
+
+public:
+	LatencyTracker(Log &logger);
+
+	// Called in Program::handleEvent() for every event, only input events are tracked
+	void handled(const SDL_Event &event, std::string_view state);
+	// Called after the frame is drawn
+	void drawn();
+	// Called after Window::update(), presented is its result
+	void presented(bool presented);
+
+	// Summaries since start, per event type, then per ProgramState
+	std::vector<Summary> getSummaries() const;
+};
+
+#endif // ifndef LATENCY_HPP
@@ -1,12 +1,51 @@
 #include "level.hpp"
+#include "profiler.hpp"
+#include <cmath>
+#include <unordered_set>
+
+namespace
+{
+	uint32_t lineKey(uint16_t v0, uint16_t v1)
+	{
+		if (v0 > v1)
+			std::swap(v0, v1);
+		return static_cast<uint32_t>(v0) << 16 | v1;
+	}
+}
 
 Level::Level(Log &logger, const std::filesystem::path &exeDir)
-	: logger{logger}, exeDir{exeDir}
+	: logger{logger}, exeDir{exeDir}, revision{0}, treesStale{false}
 {
 }
 
+KdTree::Box Level::getBox(const Line &line) const
+{
+	return KdTree::Box::around(vertices[line.v0], vertices[line.v1]);
+}
+
+void Level::updateTrees()
+{
+	if (!treesStale)
+		return;
+
+	std::vector<std::pair<uint32_t, KdTree::Box> > items;
+	items.reserve(vertices.size());
+	for (std::size_t i{0}; i < vertices.size(); ++i)
+		items.emplace_back(static_cast<uint32_t>(i), KdTree::Box{vertices[i], vertices[i]});
+	vertexTree.build(items);
+
+	items.clear();
+	items.reserve(lines.size());
+	for (const Line &line : lines)
+		items.emplace_back(lineKey(line.v0, line.v1), getBox(line));
+	lineTree.build(items);
+
+	treesStale = false;
+}
+
 bool Level::load(const std::string &levelName)
 {
+	SAL_PROFILE("Level::load");
 	auto levelPath{exeDir / "level" / levelName};
 	std::ifstream ifs{levelPath, std::ios::binary | std::ios::ate};
 	if (!ifs)
@@ -26,6 +65,9 @@ bool Level::load(const std::string &levelName)
 		return false;
 	}
 
+	// Nothing is added unless the whole file is valid
+	std::vector<Vertex> loadedVertices;
+	std::vector<Line> loadedLines;
 	try
 	{
 		std::size_t index{0};
@@ -44,7 +86,7 @@ bool Level::load(const std::string &levelName)
 			deserial(x, buffer, index);
 			double y;
 			deserial(y, buffer, index);
-			vertices.push_back({x, y});
+			loadedVertices.push_back({x, y});
 		}
 
 		while(index < std::size_t(linesEnd))
@@ -53,7 +95,7 @@ bool Level::load(const std::string &levelName)
 			deserial(v0, buffer, index);
 			uint16_t v1;
 			deserial(v1, buffer, index);
-			lines.push_back({v0, v1});
+			loadedLines.push_back({v0, v1});
 		}
 	}
 	catch (std::out_of_range &exception)
@@ -62,6 +104,25 @@ bool Level::load(const std::string &levelName)
 		return false;
 	}
 
+	if (vertices.size() + loadedVertices.size() > maxVertices)
+	{
+		WRITE_LOG(logger, Log::warning, "Level::load() failed: more than " << maxVertices << " vertices; when parsing file \"" << levelPath.string() << '\"' << std::endl);
+		return false;
+	}
+	for (const Line &line : loadedLines)
+	{
+		if (line.v0 == line.v1 || line.v0 >= loadedVertices.size() || line.v1 >= loadedVertices.size())
+		{
+			WRITE_LOG(logger, Log::warning, "Level::load() failed: invalid line (" << line.v0 << ", " << line.v1 << "); when parsing file \"" << levelPath.string() << '\"' << std::endl);
+			return false;
+		}
+	}
+
+	vertices.insert(vertices.end(), loadedVertices.begin(), loadedVertices.end());
+	lines.insert(lines.end(), loadedLines.begin(), loadedLines.end());
+	treesStale = true;
+	++revision;
+
 	WRITE_LOG(logger, Log::info, "Level::load(): successfully loaded \"" << levelPath.string() << '\"' << std::endl);
 
 	return true;
@@ -126,6 +187,10 @@ void Level::clear()
 {
 	vertices.clear();
 	lines.clear();
+	vertexTree.clear();
+	lineTree.clear();
+	treesStale = false;
+	++revision;
 }
 
 const std::vector<Level::Vertex>& Level::getVertices()
@@ -138,15 +203,23 @@ const std::list<Level::Line>& Level::getLines()
 	return lines;
 }
 
+uint64_t Level::getRevision()
+{
+	return revision;
+}
+
 bool Level::addVertex(const Vertex &vertex)
 {
 	vertices.push_back(vertex);
+	if (!treesStale)
+		vertexTree.insert(static_cast<uint32_t>(vertices.size() - 1), {vertex, vertex});
+	++revision;
 	return true;
 }
 
 bool Level::addLine(const Line &line)
 {
-	if (line.v0 == line.v1)
+	if (line.v0 == line.v1 || line.v0 >= vertices.size() || line.v1 >= vertices.size())
 		return false;
 
 	Line temp{line};
@@ -159,6 +232,9 @@ bool Level::addLine(const Line &line)
 	}
 
 	lines.push_back(temp);
+	if (!treesStale)
+		lineTree.insert(lineKey(temp.v0, temp.v1), getBox(temp));
+	++revision;
 	return true;
 }
 
@@ -182,6 +258,8 @@ bool Level::removeVertex(uint16_t index)
 		}
 	}
 
+	treesStale = true;
+	++revision;
 	return true;
 }
 
@@ -193,6 +271,335 @@ bool Level::removeLine(uint16_t v0, uint16_t v1)
 						return (line.v0 == v0 && line.v1 == v1) || (line.v0 == v1 && line.v1 == v0);
 					});
 
-	return lines.size() < prev;
+	if (lines.size() == prev)
+		return false;
+
+	if (!treesStale)
+		lineTree.erase(lineKey(v0, v1));
+	++revision;
+	return true;
+}
+
+
+bool Level::Batch::empty() const
+{
+	return vertices.empty() && lines.empty();
+}
+
+void Level::Batch::clear()
+{
+	vertices.clear();
+	lines.clear();
+}
+
+Level::Transform Level::Transform::translate(const Vec2d &offset)
+{
+	return {1.0, 0.0, 0.0, 1.0, offset};
+}
+
+Level::Transform Level::Transform::scale(double x, double y)
+{
+	return {x, 0.0, 0.0, y, {0.0, 0.0}};
+}
+
+Level::Transform Level::Transform::rotate(double radians)
+{
+	double c{std::cos(radians)};
+	double s{std::sin(radians)};
+	return {c, -s, s, c, {0.0, 0.0}};
+}
+
+Level::Vertex Level::Transform::apply(const Vertex &vertex) const
+{
+	return {xx * vertex[0] + xy * vertex[1] + offset[0],
+	        yx * vertex[0] + yy * vertex[1] + offset[1]};
+}
+
+std::size_t Level::apply(const Batch &batch, std::vector<std::size_t> *invalid)
+{
+	if (batch.empty())
+		return 0;
+	if (vertices.size() + batch.vertices.size() > maxVertices)
+	{
+		WRITE_LOG(logger, Log::warning, "Level::apply() failed: more than " << maxVertices << " vertices" << std::endl);
+		return 0;
+	}
+
+	std::size_t firstVertex{vertices.size()};
+	vertices.insert(vertices.end(), batch.vertices.begin(), batch.vertices.end());
+	// Building the trees again is faster for large batches
+	if (batch.vertices.size() + batch.lines.size() > vertexTree.size() + lineTree.size())
+		treesStale = true;
+	if (!treesStale)
+	{
+		for (std::size_t i{firstVertex}; i < vertices.size(); ++i)
+			vertexTree.insert(static_cast<uint32_t>(i), {vertices[i], vertices[i]});
+	}
+
+	std::size_t added{0};
+	std::size_t rejected{0};
+	if (!batch.lines.empty())
+	{
+		std::unordered_set<uint32_t> existing;
+		existing.reserve(lines.size() + batch.lines.size());
+		for (const Line &line : lines)
+			existing.insert(lineKey(line.v0, line.v1));
+
+		for (std::size_t i{0}; i < batch.lines.size(); ++i)
+		{
+			Line line{batch.lines[i]};
+			if (line.v0 == line.v1 || line.v0 >= vertices.size() || line.v1 >= vertices.size())
+			{
+				if (invalid)
+					invalid->push_back(i);
+				++rejected;
+				continue;
+			}
+			if (!existing.insert(lineKey(line.v0, line.v1)).second)
+				continue;
+
+			if (line.v0 > line.v1)
+				std::swap(line.v0, line.v1);
+			lines.push_back(line);
+			if (!treesStale)
+				lineTree.insert(lineKey(line.v0, line.v1), getBox(line));
+			++added;
+		}
+	}
+	if (rejected > 0)
+		WRITE_LOG(logger, Log::warning, "Level::apply(): skipped " << rejected << " invalid lines" << std::endl);
+
+	++revision;
+	return added;
+}
+
+std::size_t Level::removeVertices(const std::vector<uint16_t> &indices)
+{
+	// New ID of each vertex, or removed
+	constexpr uint32_t removed{maxVertices};
+	std::vector<uint32_t> remap(vertices.size(), 0);
+	for (uint16_t index : indices)
+	{
+		if (index < vertices.size())
+			remap[index] = removed;
+	}
+
+	std::size_t next{0};
+	for (std::size_t i{0}; i < vertices.size(); ++i)
+	{
+		if (remap[i] == removed)
+			continue;
+		vertices[next] = vertices[i];
+		remap[i] = static_cast<uint32_t>(next++);
+	}
+	std::size_t count{vertices.size() - next};
+	if (count == 0)
+		return 0;
+	vertices.resize(next);
+
+	for (auto it{lines.begin()}; it != lines.end(); )
+	{
+		if (remap[it->v0] == removed || remap[it->v1] == removed)
+		{
+			it = lines.erase(it);
+		}
+		else
+		{
+			it->v0 = static_cast<uint16_t>(remap[it->v0]);
+			it->v1 = static_cast<uint16_t>(remap[it->v1]);
+			++it;
+		}
+	}
+
+	treesStale = true;
+	++revision;
+	return count;
 }
 
+bool Level::insertVertices(const std::vector<uint16_t> &indices, const std::vector<Vertex> &inserted, const std::vector<Line> &lines)
+{
+	std::size_t size{vertices.size() + inserted.size()};
+	if (indices.size() != inserted.size() || size > maxVertices)
+	{
+		WRITE_LOG(logger, Log::warning, "Level::insertVertices() failed: invalid number of vertices" << std::endl);
+		return false;
+	}
+	for (std::size_t i{0}; i < indices.size(); ++i)
+	{
+		if (indices[i] >= size || (i > 0 && indices[i] <= indices[i - 1]))
+		{
+			WRITE_LOG(logger, Log::warning, "Level::insertVertices() failed: indices not sorted or out of range" << std::endl);
+			return false;
+		}
+	}
+	for (const Line &line : lines)
+	{
+		if (line.v0 == line.v1 || line.v0 >= size || line.v1 >= size)
+		{
+			WRITE_LOG(logger, Log::warning, "Level::insertVertices() failed: invalid line" << std::endl);
+			return false;
+		}
+	}
+	if (inserted.empty() && lines.empty())
+		return true;
+
+	// New ID of each existing vertex
+	std::vector<uint16_t> remap(vertices.size());
+	std::vector<Vertex> merged;
+	merged.reserve(size);
+	std::size_t next{0};
+	for (std::size_t i{0}; i < indices.size(); ++i)
+	{
+		while (merged.size() < indices[i])
+		{
+			remap[next] = static_cast<uint16_t>(merged.size());
+			merged.push_back(vertices[next++]);
+		}
+		merged.push_back(inserted[i]);
+	}
+	while (next < vertices.size())
+	{
+		remap[next] = static_cast<uint16_t>(merged.size());
+		merged.push_back(vertices[next++]);
+	}
+	vertices = std::move(merged);
+
+	for (Line &line : this->lines)
+	{
+		line.v0 = remap[line.v0];
+		line.v1 = remap[line.v1];
+	}
+	for (Line line : lines)
+	{
+		if (line.v0 > line.v1)
+			std::swap(line.v0, line.v1);
+		this->lines.push_back(line);
+	}
+
+	// Only inserting after the existing vertices keeps their IDs
+	if (!indices.empty() && indices.front() < remap.size())
+		treesStale = true;
+	if (!treesStale)
+	{
+		for (uint16_t index : indices)
+			vertexTree.insert(index, {vertices[index], vertices[index]});
+		for (const Line &line : lines)
+			lineTree.insert(lineKey(line.v0, line.v1), getBox(line));
+	}
+	++revision;
+	return true;
+}
+
+std::size_t Level::removeLines(const std::vector<Line> &lines)
+{
+	std::unordered_set<uint32_t> keys;
+	keys.reserve(lines.size());
+	for (const Line &line : lines)
+		keys.insert(lineKey(line.v0, line.v1));
+
+	std::size_t prev{this->lines.size()};
+	this->lines.remove_if([&keys](const Line &line)
+	                      {
+	                      	return keys.count(lineKey(line.v0, line.v1)) != 0;
+	                      });
+
+	std::size_t count{prev - this->lines.size()};
+	if (count > 0)
+	{
+		if (!treesStale)
+		{
+			for (uint32_t key : keys)
+				lineTree.erase(key);
+		}
+		++revision;
+	}
+	return count;
+}
+
+void Level::transformVertices(const std::vector<uint16_t> &indices, const Transform &transform)
+{
+	// Building the trees again is faster when most vertices are moved
+	if (indices.empty() || indices.size() > vertices.size() / 2)
+		treesStale = true;
+
+	if (indices.empty())
+	{
+		for (Vertex &vertex : vertices)
+			vertex = transform.apply(vertex);
+	}
+	else
+	{
+		// Each vertex only once, even if listed more than once
+		std::vector<bool> done(vertices.size(), false);
+		for (uint16_t index : indices)
+		{
+			if (index < vertices.size() && !done[index])
+			{
+				vertices[index] = transform.apply(vertices[index]);
+				done[index] = true;
+				if (!treesStale)
+					vertexTree.insert(index, {vertices[index], vertices[index]});
+			}
+		}
+
+		// Replaces the boxes of the lines connected to the moved vertices
+		if (!treesStale)
+		{
+			for (const Line &line : lines)
+			{
+				if (done[line.v0] || done[line.v1])
+					lineTree.insert(lineKey(line.v0, line.v1), getBox(line));
+			}
+		}
+	}
+	++revision;
+}
+
+std::optional<uint16_t> Level::pickVertex(const Vec2d &point, double eps)
+{
+	SAL_PROFILE("Level::pickVertex");
+	updateTrees();
+	auto picked{vertexTree.nearest(point, eps,
+	                               [this, &point](uint32_t item)
+	                               {
+	                               	Vec2d d{vertices[item] - point};
+	                               	return d[0] * d[0] + d[1] * d[1];
+	                               })};
+	if (!picked)
+		return std::nullopt;
+	return static_cast<uint16_t>(*picked);
+}
+
+std::optional<Level::Line> Level::pickLine(const Vec2d &point, double eps)
+{
+	SAL_PROFILE("Level::pickLine");
+	updateTrees();
+	auto picked{lineTree.nearest(point, eps,
+	                             [this, &point](uint32_t item)
+	                             {
+	                             	const Vertex &p0{vertices[item >> 16]};
+	                             	const Vertex &p1{vertices[item & 0xFFFF]};
+	                             	Vec2d segment{p1 - p0};
+	                             	Vec2d offset{point - p0};
+	                             	double length{segment[0] * segment[0] + segment[1] * segment[1]};
+	                             	double t{length > 0.0 ? std::clamp((offset[0] * segment[0] + offset[1] * segment[1]) / length, 0.0, 1.0) : 0.0};
+	                             	Vec2d d{offset - segment * t};
+	                             	return d[0] * d[0] + d[1] * d[1];
+	                             })};
+	if (!picked)
+		return std::nullopt;
+	return Line{static_cast<uint16_t>(*picked >> 16), static_cast<uint16_t>(*picked & 0xFFFF)};
+}
+
+std::vector<uint16_t> Level::findVertices(const KdTree::Box &box)
+{
+	SAL_PROFILE("Level::findVertices");
+	updateTrees();
+	std::vector<uint16_t> found;
+	vertexTree.query(box, [&found](uint32_t item)
+	                 {
+	                 	found.push_back(static_cast<uint16_t>(item));
+	                 });
+	std::sort(found.begin(), found.end());
+	return found;
+}
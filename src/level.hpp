@@ -2,9 +2,12 @@
 #define LEVEL_HPP
 
 #include "io.hpp"
+#include "kd_tree.hpp"
 #include "log.hpp"
 #include "vec.hpp"
 #include <fstream>
+#include <list>
+#include <optional>
 
 /*
  * A class to store objects of a game level,
@@ -35,6 +38,37 @@ public:
 		uint16_t v1;
 	};
 
+	// Vertex IDs are uint16_t
+	static constexpr std::size_t maxVertices{65536};
+
+	/*
+	 * Additions applied together by apply(),
+	 * lines may refer to the vertices added by the same batch
+	 */
+	struct Batch
+	{
+		std::vector<Vertex> vertices;
+		std::vector<Line> lines;
+
+		bool empty() const;
+		void clear();
+	};
+
+	// An affine transformation: x' = xx * x + xy * y + offset[0], y' = yx * x + yy * y + offset[1]
+	struct Transform
+	{
+		double xx;
+		double xy;
+		double yx;
+		double yy;
+		Vec2d offset;
+
+		static Transform translate(const Vec2d &offset);
+		static Transform scale(double x, double y);
+		static Transform rotate(double radians);
+		Vertex apply(const Vertex &vertex) const;
+	};
+
 private:
 	Log &logger;
 	const std::filesystem::path &exeDir;
@@ -42,6 +76,20 @@ private:
 	std::vector<Vertex> vertices;
 	std::list<Line> lines;
 
+	// Increased on every change to the level
+	uint64_t revision;
+
+	/*
+	 * Spatial index for picking, items are vertex IDs and line keys (v0 << 16 | v1),
+	 * updated on every change, but rebuilt on the next pick if vertex IDs changed or most vertices moved
+	 */
+	KdTree vertexTree;
+	KdTree lineTree;
+	bool treesStale;
+
+	KdTree::Box getBox(const Line &line) const;
+	void updateTrees();
+
 public:
 	Level(Log &logger, const std::filesystem::path &exeDir);
 	bool load(const std::string &levelName);
@@ -50,13 +98,44 @@ public:
 
 	const std::vector<Vertex>& getVertices();
 	const std::list<Line>& getLines();
+	uint64_t getRevision();
 	bool addVertex(const Vertex &vertex);
+	// Return false for a duplicated line, or a line to a vertex not in the level
 	bool addLine(const Line &line);
 
 	// NOTE: This also REMOVE all the lines CONNECTED TO IT,
 	//       and DECREASES the ID of vertices with ID GREATER than this vertex.
 	bool removeVertex(uint16_t index);
 	bool removeLine(uint16_t v0, uint16_t v1);
+
+	/*
+	 * Bulk versions of the above, each is a single change to the level,
+	 * checking duplicates with a hash set instead of searching the lines for each
+	 */
+
+	// Return the number of lines added, invalid (with a warning) and duplicated lines are skipped,
+	// their positions in batch.lines are appended to invalid if given,
+	// NOTHING is added if the vertices would exceed maxVertices.
+	std::size_t apply(const Batch &batch, std::vector<std::size_t> *invalid = nullptr);
+	// Return the number of vertices removed, same as removeVertex() for each, but in one pass
+	std::size_t removeVertices(const std::vector<uint16_t> &indices);
+	/*
+	 * The inverse of removeVertices(), vertices are inserted to have the IDs of the sorted indices,
+	 * and the IDs of the existing vertices are INCREASED to make room,
+	 * then lines (referring to the new IDs) are added.
+	 * Return false and change nothing if the arguments are invalid.
+	 */
+	bool insertVertices(const std::vector<uint16_t> &indices, const std::vector<Vertex> &inserted, const std::vector<Line> &lines);
+	// Return the number of lines removed
+	std::size_t removeLines(const std::vector<Line> &lines);
+	// Transform the vertices of indices, or all vertices if indices is empty
+	void transformVertices(const std::vector<uint16_t> &indices, const Transform &transform);
+
+	// The vertex or line nearest to point within eps, O(log n) on average
+	std::optional<uint16_t> pickVertex(const Vec2d &point, double eps);
+	std::optional<Line> pickLine(const Vec2d &point, double eps);
+	// Sorted IDs of the vertices inside box
+	std::vector<uint16_t> findVertices(const KdTree::Box &box);
 };
 
 #endif // ifndef LEVEL_HPP
@@ -1,7 +1,10 @@
 #include "line_shape.hpp"
+#include "profiler.hpp"
+#include "trace.hpp"
 
 void LineShape::draw(const sw::Color &color, sw::Surface &surface)
 {
+	SAL_PROFILE("LineShape::draw");
 	double x0{p0[0]}, x1{p1[0]};
 	double y0{p0[1]}, y1{p1[1]};
 	if (x0 > x1)
@@ -22,19 +25,26 @@ void LineShape::draw(const sw::Color &color, sw::Surface &surface)
 	int signX{dX > 0 ? 1 : -1}, signY{dY > 0 ? 1: -1};
 	double dError{std::abs(dY / dX)};
 	double error{0.0};
+	[[maybe_unused]] int written{0};
 	for (int x{static_cast<int>(std::round(x0))}, y{static_cast<int>(std::round(y0))}; x <= static_cast<int>(std::round(x1)); x += signX)
 	{
 		if (steep)
 		{
 			if (   y >= 0 && y < surface.getWidth()
 			    && x >= 0 && x < surface.getHeight())
+			{
 				surface(y, x) = color;
+				++written;
+			}
 		}
 		else
 		{
 			if (   x >= 0 && x < surface.getWidth()
 				&& y >= 0 && y < surface.getHeight())
+			{
 				surface(x, y) = color;
+				++written;
+			}
 		}
 
 		error += dError;
@@ -44,5 +54,6 @@ void LineShape::draw(const sw::Color &color, sw::Surface &surface)
 			error -= 1.0;
 		}
 	}
+	SAL_COUNT(Trace::pixelsWritten, written);
 }
 
@@ -1,4 +1,7 @@
 #include "log.hpp"
+#include <ctime>
+#include <iomanip>
+#include <sstream>
 
 NullBuffer::int_type NullBuffer::overflow(int_type ch)
 {
@@ -20,43 +23,683 @@ ComposedBuffer::int_type ComposedBuffer::overflow(int_type ch)
 	return ch;
 }
 
-Log::Log(Level level) : out{&buffer}, level{level}
+std::streamsize ComposedBuffer::xsputn(const char *s, std::streamsize count)
 {
+	for (std::streambuf *buffer : bufferList)
+		buffer->sputn(s, count);
+	return count;
 }
 
-void Log::lock()
+int ComposedBuffer::sync()
 {
-	mutex.lock();
+	for (std::streambuf *buffer : bufferList)
+		buffer->pubsync();
+	return 0;
 }
 
-void Log::unlock()
+Log::Site::Site(const char *file, int line) : file{file}, line{line}, id{nextSite++}
 {
-	mutex.unlock();
+}
+
+Log::Limit::Limit(const char *file, int line, Kind kind, std::uint32_t n)
+	: file{file}, line{line}, kind{kind}, n{std::min<std::uint32_t>(n, (1 << countBits) - 1)}
+{
+	Limit *head{limits.load(std::memory_order_relaxed)};
+	do
+		next = head;
+	while (!limits.compare_exchange_weak(head, this, std::memory_order_release, std::memory_order_relaxed));
+}
+
+bool Log::Limit::allow()
+{
+	bool allowed{false};
+	if (kind == sample)
+	{
+		allowed = n == 0 || state.fetch_add(1, std::memory_order_relaxed) % n == 0;
+	}
+	else
+	{
+		std::uint64_t second{static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now().time_since_epoch()).count())};
+		std::uint64_t current{state.load(std::memory_order_relaxed)};
+		while (true)
+		{
+			std::uint64_t desired;
+			if (current >> countBits != second)
+				desired = second << countBits | 1; // a new second
+			else if ((current & ((1 << countBits) - 1)) < n)
+				desired = current + 1;
+			else
+				break;
+
+			if (state.compare_exchange_weak(current, desired, std::memory_order_relaxed))
+			{
+				allowed = true;
+				break;
+			}
+		}
+	}
+
+	if (!allowed)
+		suppressed.fetch_add(1, std::memory_order_relaxed);
+	return allowed;
+}
+
+void Log::Stream::begin(Log &log, Level level, Site &site)
+{
+	this->log = &log;
+	this->site = &site;
+	output = level <= log.level;
+	binary = output && log.binary.load(std::memory_order_acquire);
+	recording = log.recorderSize.load(std::memory_order_relaxed) > 0;
+	formatting = output && !binary;
+	encoding = binary || recording;
+	if (output)
+		buffer.begin(log, level, site, binary);
+	reset();
+
+	if (encoding)
+	{
+		describing = !site.isDescribed.load(std::memory_order_acquire);
+		parts.clear();
+		partCount = 0;
+		bytes.clear();
+		bytes.push_back(static_cast<std::byte>('M'));
+		serial(static_cast<uint32_t>(site.id), bytes);
+		serial(static_cast<uint16_t>(level), bytes);
+		serial(static_cast<int64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count()), bytes);
+	}
+}
+
+void Log::Stream::end()
+{
+	if (encoding && describing)
+	{
+		std::call_once(site->described, [this]()
+		               {
+		               	std::vector<std::byte> description;
+		               	description.push_back(static_cast<std::byte>('D'));
+		               	serial(static_cast<uint32_t>(site->id), description);
+		               	std::string_view file{site->file};
+		               	serial(static_cast<uint32_t>(file.size()), description);
+		               	for (char ch : file)
+		               		description.push_back(static_cast<std::byte>(ch));
+		               	serial(static_cast<uint32_t>(site->line), description);
+		               	serial(static_cast<uint16_t>(partCount), description);
+		               	description.insert(description.end(), parts.begin(), parts.end());
+		               	log->describe(std::move(description));
+		               	site->isDescribed.store(true, std::memory_order_release);
+		               });
+	}
+	if (recording)
+		log->record(bytes);
+	if (binary)
+		buffer.sputn(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+	if (output)
+		buffer.pushRecord(true);
+}
+
+void Log::Stream::reset()
+{
+	// Formatting flags set by the last message are not kept
+	for (std::ostream *stream : {static_cast<std::ostream*>(&text), static_cast<std::ostream*>(&state)})
+	{
+		stream->flags(std::ios_base::dec | std::ios_base::skipws);
+		stream->precision(6);
+		stream->width(0);
+		stream->fill(' ');
+	}
+	state.str({});
+}
+
+bool Log::Stream::defaultFormat()
+{
+	return    state.flags() == (std::ios_base::dec | std::ios_base::skipws)
+	       && state.precision() == 6 && state.width() == 0;
+}
+
+void Log::Stream::literal(std::string_view literal)
+{
+	if (!describing)
+		return;
+	parts.push_back(static_cast<std::byte>('L'));
+	serial(static_cast<uint32_t>(literal.size()), parts);
+	for (char ch : literal)
+		parts.push_back(static_cast<std::byte>(ch));
+	++partCount;
+}
+
+void Log::Stream::argument(Tag tag)
+{
+	if (describing)
+	{
+		parts.push_back(static_cast<std::byte>('A'));
+		++partCount;
+	}
+	bytes.push_back(static_cast<std::byte>(tag));
+}
+
+void Log::Stream::encodeString(std::string_view string)
+{
+	serial(static_cast<uint32_t>(string.size()), bytes);
+	for (char ch : string)
+		bytes.push_back(static_cast<std::byte>(ch));
+}
+
+void Log::Stream::encodeState()
+{
+	argument(textTag);
+	encodeString(state.str());
+	state.str({});
+}
+
+Log::Stream& Log::Stream::operator<<(std::ostream& (*manipulator)(std::ostream&))
+{
+	if (formatting)
+		text << manipulator;
+	if (encoding && manipulator == static_cast<std::ostream& (*)(std::ostream&)>(std::endl))
+	{
+		literal("\n");
+	}
+	else if (encoding)
+	{
+		state << manipulator;
+		encodeState();
+	}
+	return *this;
+}
+
+Log::Stream& Log::Stream::operator<<(std::ios_base& (*manipulator)(std::ios_base&))
+{
+	// Only changes the formatting flags
+	if (encoding)
+		state << manipulator;
+	if (formatting)
+		text << manipulator;
+	return *this;
+}
+
+Log::Writer::Writer(Log &log, Level level, Site &site)
+{
+	localStream.begin(log, level, site);
+}
+
+Log::Writer::~Writer()
+{
+	localStream.end();
+}
+
+Log::Stream& Log::Writer::stream()
+{
+	return localStream;
+}
+
+void Log::RecordBuffer::pushRecord(bool last)
+{
+	record.size = static_cast<std::uint16_t>(pptr() - pbase());
+	record.last = last;
+	if (!dropping)
+		dropping = !log->push(record);
+	record.first = false;
+	setp(record.text.data(), record.text.data() + record.text.size());
+}
+
+void Log::RecordBuffer::begin(Log &log, Level level, const Site &site, bool binary)
+{
+	this->log = &log;
+	dropping = false;
+	record.level = level;
+	record.first = true;
+	record.binary = binary;
+	record.file = site.file;
+	record.line = site.line;
+	record.time = std::chrono::system_clock::now();
+	setp(record.text.data(), record.text.data() + record.text.size());
+}
+
+Log::RecordBuffer::int_type Log::RecordBuffer::overflow(int_type ch)
+{
+	pushRecord(false);
+	if (!traits_type::eq_int_type(ch, traits_type::eof()))
+	{
+		*pptr() = traits_type::to_char_type(ch);
+		pbump(1);
+	}
+	return traits_type::not_eof(ch);
+}
+
+Log::Ring& Log::getRing()
+{
+	for (auto &[owner, ring] : localRings)
+	{
+		if (owner == id)
+			return *ring;
+	}
+
+	std::lock_guard<std::mutex> lock{ringsMutex};
+	rings.push_back(std::make_unique<Ring>());
+	localRings.emplace_back(id, rings.back().get());
+	return *rings.back();
+}
+
+bool Log::push(const Record &record)
+{
+	Ring &ring{getRing()};
+	while (!ring.records.push(record))
+	{
+		switch (overflow.load(std::memory_order_relaxed))
+		{
+		case block:
+			wake.notify_one();
+			std::this_thread::yield();
+			break;
+
+		case count:
+			ring.dropped.fetch_add(1, std::memory_order_relaxed);
+			[[fallthrough]];
+		case drop:
+			wake.notify_one();
+			return false;
+		}
+	}
+
+	// Errors are written immediately, in case the program is about to end
+	if (record.level == error && record.last)
+		wake.notify_one();
+	return true;
+}
+
+void Log::describe(std::vector<std::byte> &&description)
+{
+	std::lock_guard<std::mutex> lock{descriptionsMutex};
+	descriptions.push_back(std::move(description));
+	descriptionsPending.store(true, std::memory_order_release);
+}
+
+void Log::record(const std::vector<std::byte> &bytes)
+{
+	Ring &ring{getRing()};
+	std::lock_guard<std::mutex> lock{ring.recorderMutex};
+	std::size_t size{recorderSize.load(std::memory_order_relaxed)};
+	if (size == 0)
+		return;
+	if (ring.recorded.size() != size)
+	{
+		ring.recorded.clear();
+		ring.recorded.resize(size);
+		ring.recordedNext = 0;
+	}
+	// Reuses the memory of the overwritten message
+	ring.recorded[ring.recordedNext].assign(bytes.begin(), bytes.end());
+	ring.recordedNext = (ring.recordedNext + 1) % size;
+}
+
+void Log::summarize()
+{
+	std::lock_guard<std::mutex> lock{drainMutex};
+	for (Limit *limit{limits.load(std::memory_order_acquire)}; limit; limit = limit->next)
+	{
+		std::uint64_t suppressed{limit->suppressed.exchange(0, std::memory_order_relaxed)};
+		if (suppressed > 0)
+		{
+			out << "[WARNING] Log: " << limit->file << ':' << limit->line << ": "
+			    << suppressed << " messages suppressed" << std::endl;
+		}
+	}
+}
+
+void Log::writeDescriptions()
+{
+	std::lock_guard<std::mutex> lock{descriptionsMutex};
+	if (binaryFile.is_open())
+	{
+		for (; descriptionsWritten < descriptions.size(); ++descriptionsWritten)
+		{
+			const std::vector<std::byte> &description{descriptions[descriptionsWritten]};
+			binaryFile.write(reinterpret_cast<const char*>(description.data()), static_cast<std::streamsize>(description.size()));
+		}
+	}
+	descriptionsPending.store(false, std::memory_order_relaxed);
+}
+
+void Log::write(const Record &record, std::string_view text)
+{
+	std::time_t second{std::chrono::system_clock::to_time_t(record.time)};
+	if (second != lastSecond)
+	{
+		std::ostringstream time;
+		time << std::put_time(std::localtime(&second), "%Y-%m-%d %H:%M:%S ");
+		lastTime = time.str();
+		lastSecond = second;
+	}
+
+	out << lastTime << '[' << levelToString[record.level] << "] "
+	    << record.file << ':' << record.line << ": ";
+	out.write(text.data(), text.size());
+}
+
+void Log::drain()
+{
+	std::lock_guard<std::mutex> drainLock{drainMutex};
+	if (descriptionsPending.load(std::memory_order_acquire))
+		writeDescriptions();
+
+	std::vector<Ring*> snapshot;
+	{
+		std::lock_guard<std::mutex> lock{ringsMutex};
+		for (auto &ring : rings)
+			snapshot.push_back(ring.get());
+	}
+
+	for (Ring *ring : snapshot)
+	{
+		ring->records.drain([this, ring](const Record &record)
+		                    {
+		                    	// A message missing its end (dropped) is discarded
+		                    	if (record.first)
+		                    		ring->partial.clear();
+		                    	// So is the rest of a message missing its beginning,
+		                    	// as fragments before the last one are full, partial is never empty within a message
+		                    	else if (ring->partial.empty())
+		                    		return;
+		                    	std::string_view text{record.text.data(), record.size};
+		                    	if (!(record.first && record.last))
+		                    	{
+		                    		ring->partial.append(text);
+		                    		if (!record.last)
+		                    			return;
+		                    		text = ring->partial;
+		                    	}
+
+		                    	if (record.binary)
+		                    	{
+		                    		// The call site may have been described after the last check
+		                    		if (descriptionsPending.load(std::memory_order_acquire))
+		                    			writeDescriptions();
+		                    		binaryFile.write(text.data(), static_cast<std::streamsize>(text.size()));
+		                    	}
+		                    	else
+		                    	{
+		                    		write(record, text);
+		                    	}
+		                    	ring->partial.clear();
+		                    });
+
+		std::uint64_t dropped{ring->dropped.exchange(0, std::memory_order_relaxed)};
+		if (dropped > 0)
+			out << "[WARNING] Log: " << dropped << " messages dropped" << std::endl;
+	}
+	out.flush();
+	if (binaryFile.is_open())
+		binaryFile.flush();
+}
+
+void Log::run()
+{
+	std::unique_lock<std::mutex> lock{wakeMutex};
+	auto lastSummary{std::chrono::steady_clock::now()};
+	while (!stopping)
+	{
+		wake.wait_for(lock, flushInterval);
+		lock.unlock();
+		drain();
+		if (std::chrono::steady_clock::now() - lastSummary >= summaryInterval)
+		{
+			summarize();
+			lastSummary = std::chrono::steady_clock::now();
+		}
+		lock.lock();
+	}
+}
+
+Log::Log(Level level)
+	: level{level}, id{nextId++}, overflow{block}, binary{false}, recorderSize{0}, descriptionsWritten{0}, descriptionsPending{false}, out{&buffer}, lastSecond{-1}, stopping{false}, thread{&Log::run, this}
+{
+}
+
+Log::~Log()
+{
+	{
+		std::lock_guard<std::mutex> lock{wakeMutex};
+		stopping = true;
+	}
+	wake.notify_one();
+	thread.join();
+	drain();
+	summarize();
 }
 
 void Log::bind(std::ostream &observer)
 {
+	std::lock_guard<std::mutex> lock{drainMutex};
 	buffer.add(observer.rdbuf());
 }
 
-std::ostream& Log::get(Level level, std::string fileName, int lineNumber)
+void Log::setOverflow(Overflow overflow)
 {
-	if (level <= this->level)
+	this->overflow.store(overflow, std::memory_order_relaxed);
+}
+
+void Log::openBinary(const std::filesystem::path &file)
+{
+	std::lock_guard<std::mutex> lock{drainMutex};
+	binaryFile.open(file, std::ios::binary | std::ios::trunc);
+	if (!binaryFile)
+		throw std::runtime_error{"Log::openBinary() failed: cannot open \"" + file.string() + '\"'};
+	binaryFile.write(binaryMagic.data(), static_cast<std::streamsize>(binaryMagic.size()));
 	{
-		auto now{std::chrono::system_clock::now()};
-		auto in_time_t{std::chrono::system_clock::to_time_t(now)};
-		out << std::put_time(std::localtime(&in_time_t), "%Y-%m-%d %H:%M:%S ")
-			<< '[' << levelToString[level] << "] "
-			<< fileName << ":" << lineNumber << ": ";
-		return out;
+		// Call sites described before are written again
+		std::lock_guard<std::mutex> descriptionsLock{descriptionsMutex};
+		descriptionsWritten = 0;
+		descriptionsPending.store(true, std::memory_order_release);
 	}
-	else
+	binary.store(true, std::memory_order_release);
+}
+
+void Log::setRecorder(std::size_t messages, const std::filesystem::path &file)
+{
+	std::lock_guard<std::mutex> lock{dumpMutex};
+	recorderFile = file;
+	recorderSize.store(messages, std::memory_order_relaxed);
+}
+
+void Log::dumpRecorder()
+{
+	// The thread that crashed may hold any of the locks
+	auto lockBriefly{[](std::mutex &mutex)
+	                 {
+	                 	std::unique_lock<std::mutex> lock{mutex, std::try_to_lock};
+	                 	for (int i{0}; i < 100 && !lock.owns_lock(); ++i)
+	                 	{
+	                 		std::this_thread::yield();
+	                 		lock.try_lock();
+	                 	}
+	                 	return lock;
+	                 }};
+
+	std::unique_lock<std::mutex> dumpLock{lockBriefly(dumpMutex)};
+	if (!dumpLock.owns_lock() || recorderSize.load(std::memory_order_relaxed) == 0)
+		return;
+
+	// Copied, so the messages do not change while being formatted
+	std::vector<std::byte> buffer;
+	std::vector<std::size_t> messages;
+	{
+		std::unique_lock<std::mutex> lock{lockBriefly(descriptionsMutex)};
+		if (!lock.owns_lock())
+			return;
+		for (const std::vector<std::byte> &description : descriptions)
+			buffer.insert(buffer.end(), description.begin(), description.end());
+	}
+	std::size_t messagesBegin{buffer.size()};
+	std::size_t skipped{0};
+	{
+		std::unique_lock<std::mutex> lock{lockBriefly(ringsMutex)};
+		if (!lock.owns_lock())
+			return;
+		for (auto &ring : rings)
+		{
+			std::unique_lock<std::mutex> recorderLock{lockBriefly(ring->recorderMutex)};
+			if (!recorderLock.owns_lock())
+			{
+				++skipped;
+				continue;
+			}
+			for (const std::vector<std::byte> &message : ring->recorded)
+			{
+				if (message.empty())
+					continue;
+				messages.push_back(buffer.size());
+				buffer.insert(buffer.end(), message.begin(), message.end());
+			}
+		}
+	}
+	std::stable_sort(messages.begin(), messages.end(),
+	                 [&buffer](std::size_t a, std::size_t b)
+	                 {
+	                 	return LogDecoder::getTime(buffer, a) < LogDecoder::getTime(buffer, b);
+	                 });
+
+	std::ofstream file{recorderFile};
+	if (!file)
+		return;
+	file << "Flight recorder: " << messages.size() << " messages";
+	if (skipped > 0)
+		file << ", " << skipped << " threads skipped";
+	file << '\n';
+	try
+	{
+		LogDecoder decoder;
+		std::size_t index{0};
+		while (index < messagesBegin)
+			decoder.decode(buffer, index, file);
+		for (std::size_t message : messages)
+		{
+			index = message;
+			decoder.decode(buffer, index, file);
+		}
+	}
+	catch (const std::exception &exception)
 	{
-		return nullOut;
+		file << "Flight recorder: " << exception.what() << '\n';
 	}
 }
 
-NullBuffer Log::nullBuffer{};
-std::ostream Log::nullOut{&Log::nullBuffer};
-std::array<std::string, 4> Log::levelToString{"ERROR", "WARNING", "INFO", "DEBUG"};
+void Log::flush()
+{
+	drain();
+}
+
+std::string LogDecoder::readString(std::vector<std::byte> &buffer, std::size_t &index)
+{
+	uint32_t size;
+	deserial(size, buffer, index);
+	if (index + size > buffer.size())
+		throw std::runtime_error{"LogDecoder::readString() failed: string out of bound"};
+	std::string string{reinterpret_cast<const char*>(buffer.data() + index), size};
+	index += size;
+	return string;
+}
+
+void LogDecoder::argument(std::ostream &out, std::vector<std::byte> &buffer, std::size_t &index)
+{
+	switch (static_cast<char>(buffer.at(index++)))
+	{
+	case Log::signedTag:
+	{
+		int64_t value;
+		deserial(value, buffer, index);
+		out << value;
+		break;
+	}
+	case Log::unsignedTag:
+	{
+		uint64_t value;
+		deserial(value, buffer, index);
+		out << value;
+		break;
+	}
+	case Log::doubleTag:
+	{
+		double value;
+		deserial(value, buffer, index);
+		out << value;
+		break;
+	}
+	case Log::boolTag:
+		out << (buffer.at(index++) != std::byte{0});
+		break;
+	case Log::textTag:
+		out << readString(buffer, index);
+		break;
+	default:
+		throw std::runtime_error{"LogDecoder::argument() failed: unknown tag"};
+	}
+}
+
+int64_t LogDecoder::getTime(std::vector<std::byte> &buffer, std::size_t index)
+{
+	// After the type, site, and level
+	index += 7;
+	int64_t time;
+	deserial(time, buffer, index);
+	return time;
+}
+
+void LogDecoder::decode(std::vector<std::byte> &buffer, std::size_t &index, std::ostream &out)
+{
+	char type{static_cast<char>(buffer.at(index++))};
+	uint32_t site;
+	deserial(site, buffer, index);
+
+	if (type == 'D')
+	{
+		Description description;
+		description.file = readString(buffer, index);
+		deserial(description.line, buffer, index);
+		uint16_t partCount;
+		deserial(partCount, buffer, index);
+		for (uint16_t i{0}; i < partCount; ++i)
+		{
+			bool isArgument{static_cast<char>(buffer.at(index++)) == 'A'};
+			description.isArgument.push_back(isArgument);
+			description.literals.push_back(isArgument ? std::string{} : readString(buffer, index));
+		}
+		descriptions[site] = std::move(description);
+	}
+	else if (type == 'M')
+	{
+		uint16_t level;
+		int64_t time;
+		deserial(level, buffer, index);
+		deserial(time, buffer, index);
+
+		auto found{descriptions.find(site)};
+		if (found == descriptions.end() || level > Log::debug)
+			throw std::runtime_error{"LogDecoder::decode() failed: message of unknown call site"};
+		const Description &description{found->second};
+
+		std::chrono::system_clock::time_point point{std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::nanoseconds{time})};
+		std::time_t second{std::chrono::system_clock::to_time_t(point)};
+		out << std::put_time(std::localtime(&second), "%Y-%m-%d %H:%M:%S ")
+		    << '[' << Log::levelToString[level] << "] "
+		    << description.file << ':' << description.line << ": ";
+		for (std::size_t i{0}; i < description.isArgument.size(); ++i)
+		{
+			if (description.isArgument[i])
+				argument(out, buffer, index);
+			else
+				out << description.literals[i];
+		}
+	}
+	else
+	{
+		throw std::runtime_error{"LogDecoder::decode() failed: unknown record type"};
+	}
+}
 
+thread_local Log::Stream Log::localStream;
+thread_local std::vector<std::pair<unsigned, Log::Ring*> > Log::localRings;
+std::atomic<unsigned> Log::nextId{0};
+std::atomic<std::uint32_t> Log::nextSite{0};
+std::atomic<Log::Limit*> Log::limits{nullptr};
+std::array<std::string_view, 4> Log::levelToString{"ERROR", "WARNING", "INFO", "DEBUG"};
@@ -1,17 +1,35 @@
 #ifndef LOG_HPP
 #define LOG_HPP
 
+#include "io.hpp"
+#include "spsc_ring.hpp"
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <cstdint>
 #include <filesystem>
+#include <fstream>
 #include <functional>
 #include <iomanip>
+#include <memory>
 #include <mutex>
 #include <ostream>
+#include <sstream>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
+// Messages with a Level number GREATER than this are removed at compile time
+#ifndef SALTFISH_LOG_LEVEL
+#define SALTFISH_LOG_LEVEL 3
+#endif
+
 /*
  * A dummy buffer to pipe into if you want to have no output
  * similar to /dev/null, etc.
@@ -37,12 +55,32 @@ public:
 
 	void add(std::streambuf *buffer);
 	int_type overflow(int_type ch) final;
+	// Forward whole blocks instead of one character at a time
+	std::streamsize xsputn(const char *s, std::streamsize count) final;
+	int sync() final;
 };
 
 /*
  * A class that allows logging to multiple ostream,
  * also suppress low-importance message according to Log Level,
  * append information like Log Level, file name, line number, and current time.
+ *
+ * Logging is asynchronous:
+ * the calling thread formats the message into records in its own lock-free ring,
+ * and a background thread adds the time and other information,
+ * and writes the messages to the bound ostreams in bulk.
+ * Messages from one thread are written in order,
+ * messages from different threads may be reordered within about flushInterval.
+ *
+ * In binary mode (see openBinary()), messages are not formatted at all:
+ * each WRITE_LOG() call site is described once in the file,
+ * with the string literals of its message,
+ * and each message only stores the call site, level, time, and its values encoded by serial().
+ * The saltfish_logdecode tool turns a binary log into text again.
+ *
+ * The flight recorder (see setRecorder()) keeps the last messages of each thread
+ * encoded the same way, including messages suppressed by the Log Level,
+ * and only formats them when dumpRecorder() is called, e.g. after a crash.
  */
 class Log
 {
@@ -55,41 +93,430 @@ public:
 		debug = 3
 	};
 
+	// What a thread does when its ring is full
+	enum Overflow
+	{
+		block, // wait for the background thread
+		drop,  // drop the message
+		count  // drop the message, and report the number of dropped messages
+	};
+
+	static constexpr Level compiledLevel{static_cast<Level>(SALTFISH_LOG_LEVEL)};
+
+	// Position of the file name in a path, used at compile time by WRITE_LOG()
+	static constexpr std::size_t fileNameOffset(std::string_view path)
+	{
+		std::size_t separator{path.find_last_of("/\\")};
+		return separator == std::string_view::npos ? 0 : separator + 1;
+	}
+
+	/*
+	 * Binary log layout, all numbers are written by serial()
+	 * file:        magic, then descriptions and messages
+	 * description: 'D', uint32_t site, string file, uint32_t line, uint16_t part count, parts
+	 * part:        'L', string literal | 'A' (an argument)
+	 * message:     'M', uint32_t site, uint16_t level, int64_t time (ns since epoch), arguments
+	 * argument:    Tag, then int64_t | uint64_t | double | uint8_t bool | string
+	 * string:      uint32_t size, bytes
+	 */
+	static constexpr std::string_view binaryMagic{"SFLOG1\n"};
+	enum Tag : char
+	{
+		signedTag   = 'i',
+		unsignedTag = 'u',
+		doubleTag   = 'd',
+		boolTag     = 'b',
+		textTag     = 's'
+	};
+
+	// A WRITE_LOG() call site
+	struct Site
+	{
+		const char *file; // without directories
+		int line;
+		std::uint32_t id;
+		std::once_flag described;
+		std::atomic<bool> isDescribed{false};
+
+		Site(const char *file, int line);
+	};
+
+	/*
+	 * A WRITE_LOG_RATE() or WRITE_LOG_SAMPLE() call site, lock-free,
+	 * shared by all Logs, so the next Log to summarize reports its suppressed messages
+	 */
+	class Limit
+	{
+	public:
+		enum Kind
+		{
+			rate,  // at most n messages per second
+			sample // 1 in n messages
+		};
+
+	private:
+		friend class Log;
+
+		const char *file; // without directories
+		const int line;
+		const Kind kind;
+		const std::uint32_t n;
+		// rate: the current second << countBits | messages in it, sample: number of messages
+		std::atomic<std::uint64_t> state{0};
+		std::atomic<std::uint64_t> suppressed{0};
+		Limit *next{nullptr};
+
+		static constexpr int countBits{24};
+
+	public:
+		Limit(const char *file, int line, Kind kind, std::uint32_t n);
+		// Whether this message is written, counted if not
+		bool allow();
+	};
+
+private:
+	static constexpr std::size_t textCapacity{200};
+	static constexpr std::chrono::milliseconds flushInterval{10};
+	static constexpr std::chrono::seconds summaryInterval{5};
+
+	// A message longer than textCapacity is split into several records
+	struct Record
+	{
+		Level level;
+		bool first;
+		bool last;
+		bool binary;
+		std::uint16_t size;
+		const char *file; // without directories
+		int line;
+		std::chrono::system_clock::time_point time;
+		std::array<char, textCapacity> text;
+	};
+
+	struct Ring
+	{
+		SpscRing<Record, 256> records;
+		std::atomic<std::uint64_t> dropped{0};
+		std::string partial; // only used by the background thread
+
+		// Flight recorder, encoded messages overwritten from the oldest
+		std::mutex recorderMutex;
+		std::vector<std::vector<std::byte> > recorded;
+		std::size_t recordedNext{0};
+	};
+
+	// Formats into a record, pushing it whenever it is full
+	class RecordBuffer : public std::streambuf
+	{
+	private:
+		Log *log;
+		Record record;
+		// A fragment of the message was dropped, so the rest of it is not pushed
+		bool dropping;
+
+	public:
+		using int_type = std::streambuf::int_type;
+
+		void begin(Log &log, Level level, const Site &site, bool binary);
+		void pushRecord(bool last);
+		int_type overflow(int_type ch) final;
+	};
+
+public:
+	// What a message is written into, see WRITE_LOG()
+	class Stream
+	{
+	private:
+		friend class Log;
+
+		RecordBuffer buffer;
+		std::ostream text{&buffer};
+
+		Log *log;
+		Site *site;
+		bool output;     // passes the Log Level
+		bool binary;     // output in binary
+		bool recording;  // kept by the flight recorder
+		bool formatting; // output in text
+		bool encoding;   // binary or recording
+		// The call site is not yet described, so its parts are recorded
+		bool describing;
+		std::vector<std::byte> bytes;
+		std::vector<std::byte> parts;
+		std::uint16_t partCount;
+		// Keeps formatting flags, and formats what cannot be encoded
+		std::ostringstream state;
+
+		void begin(Log &log, Level level, Site &site);
+		void end();
+		void reset();
+
+		bool defaultFormat();
+		void literal(std::string_view literal);
+		void argument(Tag tag);
+		void encodeString(std::string_view string);
+		// Encode the content of state as text
+		void encodeState();
+
+		template <typename T>
+		void encode(const T &value)
+		{
+			if constexpr (std::is_same_v<T, bool>)
+			{
+				if (defaultFormat())
+				{
+					argument(boolTag);
+					bytes.push_back(static_cast<std::byte>(value));
+					return;
+				}
+			}
+			else if constexpr (   std::is_same_v<T, char> || std::is_same_v<T, signed char>
+			                   || std::is_same_v<T, unsigned char>)
+			{
+				// Written as a character, so formatted
+			}
+			else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>)
+			{
+				if (defaultFormat())
+				{
+					argument(signedTag);
+					serial(static_cast<int64_t>(value), bytes);
+					return;
+				}
+			}
+			else if constexpr (std::is_integral_v<T>)
+			{
+				if (defaultFormat())
+				{
+					argument(unsignedTag);
+					serial(static_cast<uint64_t>(value), bytes);
+					return;
+				}
+			}
+			else if constexpr (std::is_floating_point_v<T>)
+			{
+				if (defaultFormat())
+				{
+					argument(doubleTag);
+					serial(static_cast<double>(value), bytes);
+					return;
+				}
+			}
+			else if constexpr (std::is_convertible_v<const T&, std::string_view>)
+			{
+				if (state.width() == 0)
+				{
+					argument(textTag);
+					encodeString(value);
+					return;
+				}
+			}
+
+			state << value;
+			encodeState();
+		}
+
+	public:
+		template <typename T>
+		Stream& operator<<(const T &value)
+		{
+			if (encoding)
+				encode(value);
+			if (formatting)
+				text << value;
+			return *this;
+		}
+
+		// String literals are only stored in the description of the call site
+		template <std::size_t size>
+		Stream& operator<<(const char (&value)[size])
+		{
+			if (encoding && state.width() == 0)
+				literal({value, std::char_traits<char>::length(value)});
+			else if (encoding)
+				encode(static_cast<const char*>(value));
+			if (formatting)
+				text << value;
+			return *this;
+		}
+
+		// Unlike literals, the content of a buffer may change
+		template <std::size_t size>
+		Stream& operator<<(char (&value)[size])
+		{
+			return *this << static_cast<const char*>(value);
+		}
+
+		Stream& operator<<(std::ostream& (*manipulator)(std::ostream&));
+		Stream& operator<<(std::ios_base& (*manipulator)(std::ios_base&));
+	};
+
+	// Formats one message, see WRITE_LOG()
+	class Writer
+	{
+	public:
+		Writer(Log &log, Level level, Site &site);
+		~Writer();
+		Writer(const Writer&) = delete;
+		Writer& operator=(const Writer&) = delete;
+		Stream& stream();
+	};
+
 private:
-	std::mutex mutex;
+	friend class LogDecoder;
+
+	static thread_local Stream localStream;
+	static thread_local std::vector<std::pair<unsigned, Ring*> > localRings;
+	static std::atomic<unsigned> nextId;
+	static std::atomic<std::uint32_t> nextSite;
+	// Limits of all call sites
+	static std::atomic<Limit*> limits;
+	static std::array<std::string_view, 4> levelToString;
+
+	const Level level; // suppress message with Level number GREATER than this
+	const unsigned id;
+	std::atomic<Overflow> overflow;
+	std::atomic<bool> binary;
+	std::atomic<std::size_t> recorderSize;
+
+	std::mutex ringsMutex;
+	std::vector<std::unique_ptr<Ring> > rings;
+
+	// Descriptions of all call sites, the ones from descriptionsWritten on are not yet written
+	std::mutex descriptionsMutex;
+	std::vector<std::vector<std::byte> > descriptions;
+	std::size_t descriptionsWritten;
+	std::atomic<bool> descriptionsPending;
+
+	// Held while dumping the flight recorder
+	std::mutex dumpMutex;
+	std::filesystem::path recorderFile;
+
+	// Held while writing to the bound ostreams
+	std::mutex drainMutex;
 	ComposedBuffer buffer;
 	std::ostream out;
-	static NullBuffer nullBuffer;
-	static std::ostream nullOut;
-	Level level; // suppress message with Level number GREATER than this
-	static std::array<std::string, 4> levelToString;
+	std::ofstream binaryFile;
+	std::time_t lastSecond;
+	std::string lastTime;
+
+	std::mutex wakeMutex;
+	std::condition_variable wake;
+	bool stopping;
+	// NOTE: Declared last, as the thread uses the members above
+	std::thread thread;
+
+	Ring& getRing();
+	// Return false if the record is dropped
+	bool push(const Record &record);
+	void describe(std::vector<std::byte> &&description);
+	void record(const std::vector<std::byte> &bytes);
+	// Report messages suppressed by limits since the last summary
+	void summarize();
+	void writeDescriptions();
+	void write(const Record &record, std::string_view text);
+	void drain();
+	void run();
 
 public:
 	Log(Level level);
-	void lock();
-	void unlock();
+	~Log();
 	void bind(std::ostream &observer);
+	void setOverflow(Overflow overflow);
+	// Write messages logged from now on to file in binary instead
+	void openBinary(const std::filesystem::path &file);
+	// Keep the last messages (0 to disable) of each thread in memory, dumped to file
+	void setRecorder(std::size_t messages, const std::filesystem::path &file);
+	/*
+	 * Format the messages kept by the flight recorder, oldest first, into the dump file
+	 * NOTE: Also called from a fatal signal handler, so it does not wait long for any lock,
+	 *       and skips what it cannot get.
+	 */
+	void dumpRecorder();
+
+	// Checked before anything else is done for a message
+	bool isEnabled(Level level) const
+	{
+		return    level <= compiledLevel
+		       && (level <= this->level || recorderSize.load(std::memory_order_relaxed) > 0);
+	}
+
+	// Write out the messages logged so far before returning
+	void flush();
+};
+
+/*
+ * Turns descriptions and messages of a binary log back into text,
+ * in the same layout as Log.
+ */
+class LogDecoder
+{
+private:
+	struct Description
+	{
+		std::string file;
+		uint32_t line;
+		std::vector<std::string> literals; // empty for an argument
+		std::vector<bool> isArgument;
+	};
+
+	std::unordered_map<uint32_t, Description> descriptions;
+
+	static std::string readString(std::vector<std::byte> &buffer, std::size_t &index);
+	void argument(std::ostream &out, std::vector<std::byte> &buffer, std::size_t &index);
+
+public:
+	// Time of the message at index, in ns since epoch
+	static int64_t getTime(std::vector<std::byte> &buffer, std::size_t index);
 
 	/*
-	 * Return a std::ostream to directly write into
-	 * RECOMMAND USING THE MACRO WRAPPER
+	 * Read the description or message at index, messages are written to out
+	 * NOTE: Throws std::runtime_error or std::out_of_range on corrupt data.
 	 */
-	std::ostream& get(Level level, std::string fileName, int lineNumber);
+	void decode(std::vector<std::byte> &buffer, std::size_t &index, std::ostream &out);
 };
 
+// The current file name, found at compile time
+#define LOG_FILE_NAME (__FILE__ + std::integral_constant<std::size_t, Log::fileNameOffset(__FILE__)>::value)
+
+// WRITE_LOG() only if ALLOW is true, ALLOW is not evaluated if the level is suppressed
+#define WRITE_LOG_IF(LOGGER, LEVEL, ALLOW, MESSAGE) \
+		( \
+			((LEVEL) <= Log::compiledLevel && (LOGGER).isEnabled(LEVEL) && (ALLOW)) \
+				? static_cast<void>(Log::Writer{LOGGER, LEVEL, \
+				                                []() -> Log::Site& \
+				                                { \
+				                                	static Log::Site site{LOG_FILE_NAME, __LINE__}; \
+				                                	return site; \
+				                                }()}.stream() << MESSAGE) \
+				: static_cast<void>(0) \
+		)
+
 /*
- * An easy macro wrapper for Log::get(),
+ * An easy macro wrapper for Log::Writer,
  * inserts current file name and line number,
- * also HANDLES LOCKING,
  * MESSAGE should be connected with << operator.
+ * MESSAGE is not evaluated if the level is suppressed,
+ * and with a constant LEVEL above SALTFISH_LOG_LEVEL, the whole call is optimized out.
  */
-#define WRITE_LOG(LOGGER, LEVEL, MESSAGE) \
-		( \
-			(LOGGER.lock()), \
-			(LOGGER.get(LEVEL, std::filesystem::path{__FILE__}.filename(), __LINE__) << MESSAGE), \
-			(LOGGER.unlock()) \
-		)
+#define WRITE_LOG(LOGGER, LEVEL, MESSAGE) WRITE_LOG_IF(LOGGER, LEVEL, true, MESSAGE)
 
+#define WRITE_LOG_LIMITED(LOGGER, LEVEL, KIND, N, MESSAGE) \
+		WRITE_LOG_IF(LOGGER, LEVEL, \
+		             ([]() -> Log::Limit& \
+		              { \
+		              	static Log::Limit limit{LOG_FILE_NAME, __LINE__, KIND, N}; \
+		              	return limit; \
+		              }().allow()), \
+		             MESSAGE)
 
-#endif // ifndef LOG_HPP
+/*
+ * For messages that may be written every frame,
+ * WRITE_LOG() at most N (a constant) times per second, or 1 in N times,
+ * the number of suppressed messages is written every Log::summaryInterval
+ */
+#define WRITE_LOG_RATE(LOGGER, LEVEL, N, MESSAGE) WRITE_LOG_LIMITED(LOGGER, LEVEL, Log::Limit::rate, N, MESSAGE)
+#define WRITE_LOG_SAMPLE(LOGGER, LEVEL, N, MESSAGE) WRITE_LOG_LIMITED(LOGGER, LEVEL, Log::Limit::sample, N, MESSAGE)
 
+
+#endif // ifndef LOG_HPP
@@ -1,6 +1,25 @@
 #include "program.hpp"
+#include "batch_runner.hpp"
+#include "frame_scheduler.hpp"
+#include "motion_coalescer.hpp"
+#include "trace.hpp"
+#include <csignal>
 #include <iostream>
 
+namespace
+{
+	Log *recorderLog{nullptr};
+
+	// Best effort, as formatting is not async-signal-safe, but the program is ending anyway
+	void dumpOnSignal(int signal)
+	{
+		if (recorderLog)
+			recorderLog->dumpRecorder();
+		std::signal(signal, SIG_DFL);
+		std::raise(signal);
+	}
+}
+
 int main(int argc, char *argv[])
 {
 	// check hardware compatibility for double float
@@ -46,6 +65,22 @@ int main(int argc, char *argv[])
 	namespace fs = std::filesystem;
 	fs::path exeDir{fs::current_path() / fs::path{argv[0]}.parent_path()};
 
+	// Headless, without initializing SDL
+	if (argc == 3 && std::string_view{argv[1]} == "--batch")
+	{
+		try
+		{
+			Level level{logger, exeDir};
+			BatchRunner runner{logger, level};
+			return runner.run(argv[2]) ? 0 : 1;
+		}
+		catch(const std::exception &exception)
+		{
+			WRITE_LOG(logger, Log::error, "Caught std::exception: " << exception.what() << std::endl);
+			return 1;
+		}
+	}
+
 	try
 	{
 		if (SDL_Init(SDL_INIT_VIDEO) < 0)
@@ -57,6 +92,7 @@ int main(int argc, char *argv[])
 		if (std::atexit(SDL_Quit) != 0)
 			throw std::runtime_error{"Registration of SDL_Quit() failed"};
 		WRITE_LOG(logger, Log::info, "Initialized SDL" << std::endl);
+		UI::installEventFilter();
 
 		if (TTF_Init() == -1)
 		{
@@ -69,30 +105,98 @@ int main(int argc, char *argv[])
 		WRITE_LOG(logger, Log::info, "Initialized SDL_ttf" << std::endl);
 
 		Config config{logger};
+		Settings settings{config};
 		if (!config.loadFromFile(exeDir / "saltfish.conf"))
 			throw std::runtime_error{"FATAL: cannot open config file"};
 
-		sw::Window window{logger, "saltfish", config};
-		Program program{logger, exeDir, window};
+		// What a thread does when logging faster than messages are written
+		if (settings.logOverflow.get() == "drop")
+			logger.setOverflow(Log::drop);
+		else if (settings.logOverflow.get() == "count")
+			logger.setOverflow(Log::count);
+
+		// Messages are written as a binary log to "log.binary" if set, see saltfish_logdecode
+		if (!settings.logBinary.get().empty())
+			logger.openBinary(exeDir / settings.logBinary.get());
+
+		/*
+		 * The flight recorder keeps the last "log.recorder" messages of each thread at all Log Levels,
+		 * dumped to "log.recorderFile" on a crash or by F5
+		 */
+		logger.setRecorder(settings.logRecorder.get(), exeDir / settings.logRecorderFile.get());
+		recorderLog = &logger;
+		for (int signal : {SIGSEGV, SIGABRT, SIGFPE, SIGILL})
+			std::signal(signal, dumpOnSignal);
+
+		sw::Window window{logger, "saltfish", settings};
+
+		// Tracing is started by F4, or at startup if "trace.enable" is 1
+		Trace::setThreadName("main");
+		Trace::setPath(exeDir / settings.traceFile.get());
+		if (settings.traceEnable.get())
+		{
+			try
+			{
+				Trace::start();
+			}
+			catch (const std::runtime_error &exception)
+			{
+				WRITE_LOG(logger, Log::warning, exception.what() << std::endl);
+			}
+		}
+
+		// Font files are read only once, either here or on first use
+		FontCache fontCache{logger};
+		std::stringstream preloadStream{settings.fontPreload.get()};
+		std::string fontName;
+		while (std::getline(preloadStream, fontName, ','))
+		{
+			if (!fontName.empty())
+				fontCache.preload(exeDir / "font" / fontName);
+		}
+
+		// Prerendered widget sprites, 32 MiB by default
+		SpriteCache spriteCache{settings.spriteCacheBytes.get()};
+
+		Program program{logger, exeDir, window, fontCache, spriteCache};
+		FrameScheduler scheduler{logger, settings, window};
 
 		SDL_Event event;
+		// Mouse motion is handled at most once in a row per frame
+		MotionCoalescer coalescer;
+		auto dispatch{[&window, &program](const SDL_Event &event)
+		              {
+		              	window.handleEvent(event);
+		              	program.handleEvent(event);
+		              }};
 		// main loop
 		while(!program.isExited())
 		{
+			// Sleep until something happens when there is nothing to draw
+			if (scheduler.waitIdle(program.isIdle(), event))
+				coalescer.add(event, dispatch);
 			while (SDL_PollEvent(&event))
-				program.handleEvent(event);
+				coalescer.add(event, dispatch);
+			coalescer.flush(dispatch);
+			// Resize events are coalesced to once per frame
+			if (window.refreshSurface())
+				program.reInit();
 			program.update();
-			window.update();
+			program.presented(window.update());
+			Profiler::endFrame();
+			scheduler.pace();
 		}
 	}
 	catch(const std::runtime_error &exception)
 	{
 		WRITE_LOG(logger, Log::error, "Caught std::runtime_error: " << exception.what() << std::endl);
+		logger.dumpRecorder();
 		return 1;
 	}
 	catch(...)
 	{
 		WRITE_LOG(logger, Log::error, "Caught Unknown Exception" << std::endl);
+		logger.dumpRecorder();
 		return 1;
 	}
 
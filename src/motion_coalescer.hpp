@@ -0,0 +1,73 @@
+#ifndef MOTION_COALESCER_HPP
+#define MOTION_COALESCER_HPP
+
+#include <SDL.h>
+
+/*
+ * Merges runs of mouse motion events, so that a high-rate mouse
+ * does not make widgets handle more than one motion per run.
+ *
+ * A merged event carries the position of the latest event,
+ * the relative motion summed over the run,
+ * and the timestamp of the earliest event, so the time it was queued is not under-reported.
+ * Motions are only merged while the button state stays the same,
+ * and any other event first dispatches the pending motion,
+ * so the order of events is kept.
+ */
+class MotionCoalescer
+{
+private:
+	SDL_Event pending;
+	bool hasPending;
+
+	bool mergeable(const SDL_MouseMotionEvent &motion) const
+	{
+		return    hasPending
+		       && pending.motion.windowID == motion.windowID
+		       && pending.motion.which == motion.which
+		       && pending.motion.state == motion.state;
+	}
+
+public:
+	MotionCoalescer() : pending{}, hasPending{false}
+	{
+	}
+
+	// Hold back mouse motion events, dispatch(event) anything else
+	template <typename Dispatch>
+	void add(const SDL_Event &event, Dispatch dispatch)
+	{
+		if (event.type != SDL_MOUSEMOTION)
+		{
+			flush(dispatch);
+			dispatch(event);
+			return;
+		}
+
+		if (mergeable(event.motion))
+		{
+			pending.motion.x = event.motion.x;
+			pending.motion.y = event.motion.y;
+			pending.motion.xrel += event.motion.xrel;
+			pending.motion.yrel += event.motion.yrel;
+			return;
+		}
+
+		flush(dispatch);
+		pending = event;
+		hasPending = true;
+	}
+
+	// Dispatch the held back motion, called after the last event of a frame
+	template <typename Dispatch>
+	void flush(Dispatch dispatch)
+	{
+		if (hasPending)
+		{
+			hasPending = false;
+			dispatch(pending);
+		}
+	}
+};
+
+#endif // ifndef MOTION_COALESCER_HPP
@@ -1,8 +1,41 @@
 #include "pixels.hpp"
+#include <algorithm>
 
 namespace sw
 {
 
+void mergeRects(std::vector<Rect> &rects)
+{
+	rects.erase(std::remove_if(rects.begin(), rects.end(),
+	                           [](const Rect &rect){ return SDL_RectEmpty(&rect); }),
+	            rects.end());
+
+	// The union may overlap with rectangles already checked,
+	// so keep merging until nothing changes.
+	bool merged{true};
+	while (merged)
+	{
+		merged = false;
+		for (std::size_t i{0}; i < rects.size(); ++i)
+		{
+			for (std::size_t j{i + 1}; j < rects.size(); )
+			{
+				if (SDL_HasIntersection(&rects[i], &rects[j]))
+				{
+					SDL_UnionRect(&rects[i], &rects[j], &rects[i]);
+					rects[j] = rects.back();
+					rects.pop_back();
+					merged = true;
+				}
+				else
+				{
+					++j;
+				}
+			}
+		}
+	}
+}
+
 PixelView::PixelView(Uint8 *const pixel, const SDL_PixelFormat *const format) : pixel{pixel}, format{format}
 {
 }
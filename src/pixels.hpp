@@ -8,6 +8,7 @@
 #include <SDL.h>
 #include <stdexcept>
 #include <utility>
+#include <vector>
 
 namespace sw // Sdl Wrapper
 {
@@ -19,6 +20,12 @@ using Rect = SDL_Rect;
 using Color = SDL_Color;
 using ColorPair = std::pair<sw::Color, sw::Color>;
 
+/*
+ * Merge the overlapping rectangles in a list into their union,
+ * empty rectangles are removed.
+ */
+void mergeRects(std::vector<Rect> &rects);
+
 /*
  * A wrapper(reference) for a pixel on SDL_Surface
  */
@@ -0,0 +1,98 @@
+#include "profile_overlay.hpp"
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+void ProfileOverlay::renderLines()
+{
+	lines.clear();
+
+	std::ostringstream line;
+	line << std::fixed << std::setprecision(2)
+	     << "frame avg " << Profiler::getAverageFrame() * 1e3
+	     << " ms  max " << Profiler::getMaxFrame() * 1e3 << " ms";
+	lines.push_back(font->renderBlended(line.str(), textColor));
+
+	std::size_t maxLines{static_cast<std::size_t>(std::max(static_cast<int>(real.h * (1.0 - graphRatio)) / lineHeight, 1))};
+	const std::vector<Profiler::ZoneStats> &zones{Profiler::getZones()};
+	for (std::size_t i{0}; i < zones.size() && i < maxZones && lines.size() < maxLines; ++i)
+	{
+		line.str("");
+		line << std::setw(22) << std::left << zones[i].name << std::right
+		     << std::setprecision(3)
+		     << " avg " << std::setw(7) << zones[i].average * 1e3
+		     << " max " << std::setw(7) << zones[i].max * 1e3
+		     << std::setprecision(1)
+		     << " x" << zones[i].callsPerFrame;
+		lines.push_back(font->renderBlended(line.str(), textColor));
+	}
+
+	// Input-to-photon latency in ms
+	for (const LatencyTracker::Summary &summary : latency.getSummaries())
+	{
+		if (lines.size() >= maxLines)
+			break;
+		line.str("");
+		line << std::setw(22) << std::left << summary.name << std::right
+		     << std::setprecision(1)
+		     << " p50 " << std::setw(5) << summary.p50
+		     << " p95 " << std::setw(5) << summary.p95
+		     << " p99 " << std::setw(5) << summary.p99;
+		lines.push_back(font->renderBlended(line.str(), textColor));
+	}
+
+	renderedPublished = Profiler::getPublished();
+}
+
+ProfileOverlay::ProfileOverlay(const DoubleRect &dimension, const LatencyTracker &latency, FontCache &fontCache, const std::filesystem::path &fontPath)
+	: Widget{dimension}, latency{latency}, fontCache{fontCache}, fontPath{fontPath}, lineHeight{1}, renderedPublished{0}
+{
+}
+
+void ProfileOverlay::reInit(int wScreen, int hScreen)
+{
+	Widget::reInit(wScreen, hScreen);
+	font = fontCache.get(fontPath, std::max(hScreen / 50, 8));
+	font->sizeText("0", nullptr, &lineHeight);
+	lineHeight = std::max(lineHeight, 1);
+	renderLines();
+}
+
+void ProfileOverlay::draw(sw::Surface &surface)
+{
+	if (renderedPublished != Profiler::getPublished())
+		renderLines();
+
+	surface.fillRect(&real, backgroundColor);
+
+	int y{real.y};
+	for (sw::Surface &line : lines)
+	{
+		sw::Rect dstRect{real.x, y, 0, 0};
+		line.blit(surface, nullptr, &dstRect);
+		y += lineHeight;
+	}
+
+	// Frame time graph, oldest on the left
+	int graphHeight{static_cast<int>(real.h * graphRatio)};
+	int graphBottom{real.y + real.h};
+	std::size_t oldest;
+	const std::array<float, Profiler::frameHistory> &frameTimes{Profiler::getFrameTimes(oldest)};
+	for (int x{0}; x < real.w; ++x)
+	{
+		std::size_t index{(oldest + static_cast<std::size_t>(x) * Profiler::frameHistory / real.w) % Profiler::frameHistory};
+		double ratio{std::min(frameTimes[index] / graphScale, 1.0)};
+		int height{static_cast<int>(ratio * graphHeight)};
+		sw::Rect bar{real.x + x, graphBottom - height, 1, height};
+		surface.fillRect(&bar, ratio > 0.5 ? slowBarColor : barColor);
+	}
+	// Half of the graph is one frame at 60 Hz
+	sw::Rect target{real.x, graphBottom - graphHeight / 2, real.w, 1};
+	surface.fillRect(&target, targetColor);
+}
+
+bool ProfileOverlay::isAnimating()
+{
+	// The frame time graph changes every frame
+	return true;
+}
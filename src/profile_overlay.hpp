@@ -0,0 +1,48 @@
+#ifndef PROFILE_OVERLAY_HPP
+#define PROFILE_OVERLAY_HPP
+
+#include "latency.hpp"
+#include "profiler.hpp"
+#include "ui.hpp"
+#include <filesystem>
+#include <vector>
+
+/*
+ * Overlay showing the statistics collected by Profiler:
+ * frame times, per-zone averages and maxima, and input latency percentiles as text,
+ * and a graph of recent frame times at the bottom.
+ *
+ * The overlay is not part of any UI, it is drawn over everything else every frame while shown.
+ */
+class ProfileOverlay final : public Widget
+{
+private:
+	static constexpr std::size_t maxZones{12};
+	static constexpr double graphScale{1.0 / 30.0}; // frame time at the top of the graph, in seconds
+	static constexpr double graphRatio{0.3};        // graph height / widget height
+
+	const sw::Color textColor{255, 255, 255, 255};
+	const sw::Color backgroundColor{0, 0, 0, 255};
+	const sw::Color barColor{0, 200, 0, 255};
+	const sw::Color slowBarColor{220, 40, 40, 255};
+	const sw::Color targetColor{255, 255, 0, 255};
+
+	const LatencyTracker &latency;
+	FontCache &fontCache;
+	std::filesystem::path fontPath;
+	FontCache::Handle font;
+	int lineHeight;
+
+	std::vector<sw::Surface> lines;
+	std::uint64_t renderedPublished;
+
+	void renderLines();
+
+public:
+	ProfileOverlay(const DoubleRect &dimension, const LatencyTracker &latency, FontCache &fontCache, const std::filesystem::path &fontPath);
+	void reInit(int wScreen, int hScreen) override;
+	void draw(sw::Surface &surface) override;
+	bool isAnimating() override;
+};
+
+#endif // ifndef PROFILE_OVERLAY_HPP
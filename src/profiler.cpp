@@ -0,0 +1,156 @@
+#include "profiler.hpp"
+#include <algorithm>
+#include <chrono>
+
+std::mutex Profiler::ringsMutex;
+std::vector<std::unique_ptr<Profiler::Ring> > Profiler::rings;
+thread_local Profiler::LocalRing Profiler::localRing;
+
+std::unordered_map<std::string_view, Profiler::Accumulator> Profiler::accumulators;
+Profiler::tick_t Profiler::periodBegin{Profiler::now()};
+Profiler::tick_t Profiler::lastFrame{Profiler::now()};
+int Profiler::framesInPeriod{0};
+Profiler::tick_t Profiler::frameTotal{0};
+Profiler::tick_t Profiler::frameMax{0};
+
+std::vector<Profiler::ZoneStats> Profiler::zones;
+double Profiler::averageFrame{0.0};
+double Profiler::maxFrame{0.0};
+std::array<float, Profiler::frameHistory> Profiler::frameTimes{};
+std::size_t Profiler::frameIndex{0};
+std::uint64_t Profiler::published{0};
+
+Profiler::LocalRing::~LocalRing()
+{
+	if (ring)
+		ring->used.store(false, std::memory_order_release);
+}
+
+Profiler::Ring& Profiler::getRing()
+{
+	if (!localRing.ring)
+	{
+		std::lock_guard<std::mutex> lock{ringsMutex};
+		for (auto &ring : rings)
+		{
+			if (!ring->used.load(std::memory_order_acquire))
+			{
+				ring->used.store(true, std::memory_order_relaxed);
+				localRing.ring = ring.get();
+				break;
+			}
+		}
+		if (!localRing.ring)
+		{
+			rings.push_back(std::make_unique<Ring>());
+			localRing.ring = rings.back().get();
+		}
+	}
+	return *localRing.ring;
+}
+
+void Profiler::drain(Ring &ring)
+{
+	ring.samples.drain([](const Sample &sample)
+	           {
+	           	Accumulator &accumulator{accumulators[sample.name]};
+	           	tick_t duration{sample.end - sample.begin};
+	           	++accumulator.calls;
+	           	accumulator.total += duration;
+	           	accumulator.max = std::max(accumulator.max, duration);
+	           });
+}
+
+void Profiler::publish(tick_t time)
+{
+	static constexpr double toSeconds{1e-9};
+
+	zones.clear();
+	std::vector<std::pair<tick_t, ZoneStats> > sorted;
+	for (auto &[name, accumulator] : accumulators)
+	{
+		if (accumulator.calls == 0)
+			continue;
+		sorted.push_back({accumulator.total,
+		                  {name,
+		                   static_cast<double>(accumulator.calls) / framesInPeriod,
+		                   accumulator.total * toSeconds / accumulator.calls,
+		                   accumulator.max * toSeconds}});
+		accumulator = Accumulator{};
+	}
+	std::sort(sorted.begin(), sorted.end(),
+	          [](const auto &a, const auto &b){ return a.first > b.first; });
+	for (auto &entry : sorted)
+		zones.push_back(entry.second);
+
+	averageFrame = frameTotal * toSeconds / framesInPeriod;
+	maxFrame = frameMax * toSeconds;
+
+	periodBegin = time;
+	framesInPeriod = 0;
+	frameTotal = 0;
+	frameMax = 0;
+	++published;
+}
+
+Profiler::tick_t Profiler::now()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Profiler::record(const Sample &sample)
+{
+	// The sample is dropped rather than waiting for the main thread
+	getRing().samples.push(sample);
+	if (Trace::isEnabled())
+		Trace::zone(sample.name, sample.begin, sample.end);
+}
+
+void Profiler::endFrame()
+{
+	tick_t time{now()};
+	tick_t frame{time - lastFrame};
+	Trace::endFrame(lastFrame, time);
+	lastFrame = time;
+
+	frameTimes[frameIndex] = static_cast<float>(frame * 1e-9);
+	frameIndex = (frameIndex + 1) % frameHistory;
+	++framesInPeriod;
+	frameTotal += frame;
+	frameMax = std::max(frameMax, frame);
+
+	{
+		std::lock_guard<std::mutex> lock{ringsMutex};
+		for (auto &ring : rings)
+			drain(*ring);
+	}
+
+	if (time - periodBegin >= period)
+		publish(time);
+}
+
+const std::vector<Profiler::ZoneStats>& Profiler::getZones()
+{
+	return zones;
+}
+
+double Profiler::getAverageFrame()
+{
+	return averageFrame;
+}
+
+double Profiler::getMaxFrame()
+{
+	return maxFrame;
+}
+
+const std::array<float, Profiler::frameHistory>& Profiler::getFrameTimes(std::size_t &index)
+{
+	index = frameIndex;
+	return frameTimes;
+}
+
+std::uint64_t Profiler::getPublished()
+{
+	return published;
+}
@@ -0,0 +1,148 @@
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+
+#include "spsc_ring.hpp"
+#include "trace.hpp"
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/*
+ * Profiling zones
+ *
+ * SAL_PROFILE("name") times the rest of the enclosing scope.
+ * Each thread records finished zones into its own ring buffer without locking,
+ * and the main thread collects them once per frame in Profiler::endFrame().
+ *
+ * Zones are only compiled in when SALTFISH_PROFILE is defined (CMake option of the same name),
+ * otherwise SAL_PROFILE() expands to nothing.
+ * Frame times are always collected.
+ *
+ * NOTE: name must be a string literal (or otherwise outlive the program),
+ *       as only the pointer is stored.
+ */
+#define SAL_PROFILE_CONCAT_IMPL(a, b) a##b
+#define SAL_PROFILE_CONCAT(a, b) SAL_PROFILE_CONCAT_IMPL(a, b)
+#ifdef SALTFISH_PROFILE
+#define SAL_PROFILE(name) Profiler::Zone SAL_PROFILE_CONCAT(profileZone, __LINE__){name}
+#else
+#define SAL_PROFILE(name) ((void)0)
+#endif
+
+class Profiler
+{
+public:
+	// Nanoseconds since an arbitrary epoch
+	using tick_t = std::int64_t;
+
+	struct Sample
+	{
+		const char *name;
+		tick_t begin;
+		tick_t end;
+	};
+
+	// Statistics of one zone over the last period
+	struct ZoneStats
+	{
+		std::string_view name;
+		double callsPerFrame;
+		double average; // seconds per call
+		double max;     // seconds
+	};
+
+	class Zone
+	{
+	private:
+		const char *name;
+		tick_t begin;
+
+	public:
+		explicit Zone(const char *name) : name{name}, begin{now()}
+		{
+		}
+
+		~Zone()
+		{
+			record({name, begin, now()});
+		}
+
+		Zone(const Zone&) = delete;
+		Zone& operator=(const Zone&) = delete;
+	};
+
+	static constexpr std::size_t frameHistory{240};
+
+private:
+	static constexpr tick_t period{500'000'000}; // statistics are published every 0.5s
+
+	// Filled by the owning thread, drained by the main thread
+	struct Ring
+	{
+		SpscRing<Sample, 4096> samples;
+		// false after the owning thread exits, so the ring can be taken by another thread
+		std::atomic<bool> used{true};
+	};
+
+	// Gives the ring of a thread back when the thread exits
+	struct LocalRing
+	{
+		Ring *ring{nullptr};
+
+		~LocalRing();
+	};
+
+	struct Accumulator
+	{
+		int calls{0};
+		tick_t total{0};
+		tick_t max{0};
+	};
+
+	// Rings are never freed, as samples may still be left in them after their thread exits,
+	// but the ring of an exited thread is reused by the next thread needing one
+	static std::mutex ringsMutex;
+	static std::vector<std::unique_ptr<Ring> > rings;
+	static thread_local LocalRing localRing;
+
+	static std::unordered_map<std::string_view, Accumulator> accumulators;
+	static tick_t periodBegin;
+	static tick_t lastFrame;
+	static int framesInPeriod;
+	static tick_t frameTotal;
+	static tick_t frameMax;
+
+	static std::vector<ZoneStats> zones;
+	static double averageFrame;
+	static double maxFrame;
+	static std::array<float, frameHistory> frameTimes;
+	static std::size_t frameIndex;
+	static std::uint64_t published;
+
+	static Ring& getRing();
+	static void drain(Ring &ring);
+	static void publish(tick_t time);
+
+public:
+	static tick_t now();
+	static void record(const Sample &sample);
+
+	// Called by the main thread once per frame
+	static void endFrame();
+
+	// Zones over the last period, sorted by total time descending
+	static const std::vector<ZoneStats>& getZones();
+	static double getAverageFrame();
+	static double getMaxFrame();
+	// Frame times in seconds, index is the position of the oldest entry
+	static const std::array<float, frameHistory>& getFrameTimes(std::size_t &index);
+	// Increased each time the statistics are published
+	static std::uint64_t getPublished();
+};
+
+#endif // ifndef PROFILER_HPP
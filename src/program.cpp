@@ -1,6 +1,8 @@
 #include "program.hpp"
+#include <algorithm>
+#include <cmath>
 
-ProgramState::ProgramState(Program &program) : program{program}, ui{program.window.getSurface()}, next{nullptr}
+ProgramState::ProgramState(Program &program) : program{program}, ui{program.window}, next{nullptr}
 {
 }
 
@@ -17,26 +19,60 @@ std::unique_ptr<ProgramState> ProgramState::handleEvent(const SDL_Event &event)
 	return std::move(next);
 }
 
-void ProgramState::update()
+void ProgramState::step([[maybe_unused]] double dt)
+{
+}
+
+void ProgramState::update([[maybe_unused]] double alpha)
 {
 	ui.update();
 }
 
-void MenuState::Background::draw(sw::Surface &surface)
+void ProgramState::reInit()
+{
+	ui.reInit(program.window);
+}
+
+bool ProgramState::isIdle()
+{
+	return ui.isIdle();
+}
+
+void ProgramState::damageArea(const sw::Rect &area)
 {
-	for (int col{0}; col < real.w; ++col)
+	ui.damageArea(area);
+}
+
+void MenuState::Background::reInit(int wScreen, int hScreen)
+{
+	Widget::reInit(wScreen, hScreen);
+	if (cache)
+		cache.free();
+	cache.create(real.w, real.h);
+	cache.setBlendMode(SDL_BLENDMODE_NONE);
+
+	// Filled by tiles as this is done on every step of resizing
+	const int tile{150};
+	for (int col{0}; col < real.w; col += tile)
 	{
-		for (int row{0}; row < real.h; ++row)
+		for (int row{0}; row < real.h; row += tile)
 		{
-			if ((col / 150 + row / 150) & 1)
-				surface(col, row) = {0, 230, 50, 255};
+			sw::Rect rect{col, row, tile, tile};
+			if ((col / tile + row / tile) & 1)
+				cache.fillRect(&rect, {0, 230, 50, 255});
 			else
-				surface(col, row) = {50, 150, 0, 255};
+				cache.fillRect(&rect, {50, 150, 0, 255});
 		}
 	}
 }
 
-MenuState::MenuState(Program &program) : ProgramState{program}, background{{0.0, 0.0, 1.0, 1.0}}, menu{makeMainMenu({0.2, 0.4, 0.6, 0.4}, 0.1, 0.01, program.exeDir / "font")}
+void MenuState::Background::draw(sw::Surface &surface)
+{
+	sw::Rect dstRect{real};
+	cache.blit(surface, nullptr, &dstRect);
+}
+
+MenuState::MenuState(Program &program) : ProgramState{program}, background{{0.0, 0.0, 1.0, 1.0}}, menu{makeMainMenu({0.2, 0.4, 0.6, 0.4}, 0.1, 0.01, program.fontCache, program.exeDir / "font", program.spriteCache)}
 {
 	ui.add(background);
 	menu.add({"Start Game", [this](){ this->next = std::make_unique<GameState>(this->program); }});
@@ -46,10 +82,19 @@ MenuState::MenuState(Program &program) : ProgramState{program}, background{{0.0,
 	ui.add(menu);
 }
 
-GameState::GameState(Program &program) : ProgramState{program}
+std::string_view MenuState::getName() const
+{
+	return "MenuState";
+}
+
+GameState::GameState(Program &program)
+	: ProgramState{program}, previous{{0.0, 0.0}, {0.3, 0.2}}, current{previous}
 {
-	sw::Font font{program.exeDir / "font" / "Terminus-Bold.ttf", 50};
-	line1 = font.renderBlended("ESC: Pause Game", {255, 255, 255, 255});
+	// Keyboard is handled by GameState::handleEvent() itself
+	ui.requireEvents(Widget::keyEvent);
+
+	FontCache::Handle font{program.fontCache.get(program.exeDir / "font" / "Terminus-Bold.ttf", 50)};
+	line1 = font->renderBlended("ESC: Pause Game", {255, 255, 255, 255});
 }
 
 std::unique_ptr<ProgramState> GameState::handleEvent(const SDL_Event &event)
@@ -75,15 +120,47 @@ std::unique_ptr<ProgramState> GameState::handleEvent(const SDL_Event &event)
 	}
 }
 
-void GameState::update()
+void GameState::step(double dt)
 {
-	program.window.getSurface().fillRect(nullptr, {0, 0, 0, 255});
-	sw::Rect dist1{200, 50, -1, -1};
-	line1.blit(program.window.getSurface(), nullptr, &dist1);
+	previous = current;
+	current.position += current.velocity * dt;
+	// Bounce off the edges of the window
+	for (std::size_t i{0}; i < 2; ++i)
+	{
+		if (current.position[i] < 0.0 || current.position[i] > 1.0)
+		{
+			current.velocity[i] = -current.velocity[i];
+			current.position[i] = std::clamp(current.position[i], 0.0, 1.0);
+		}
+	}
+}
+
+void GameState::update(double alpha)
+{
+	sw::Surface &surface{program.window.getSurface()};
+	surface.fillRect(nullptr, {0, 0, 0, 255});
+
+	Vec2d position{previous.position * (1.0 - alpha) + current.position * alpha};
+	sw::Rect dist1{static_cast<int>(position[0] * std::max(surface.getWidth() - line1.getWidth(), 0)),
+	               static_cast<int>(position[1] * std::max(surface.getHeight() - line1.getHeight(), 0)),
+	               -1, -1};
+	line1.blit(surface, nullptr, &dist1);
+	program.window.addDamage(nullptr);
+}
+
+bool GameState::isIdle()
+{
+	// The game is redrawn every frame
+	return false;
+}
+
+std::string_view GameState::getName() const
+{
+	return "GameState";
 }
 
 PauseState::PauseState(Program &program)
-	: ProgramState{program}, menu{makeMainMenu({0.2, 0.4, 0.6, 0.4}, 0.1, 0.01, program.exeDir / "font")}
+	: ProgramState{program}, menu{makeMainMenu({0.2, 0.4, 0.6, 0.4}, 0.1, 0.01, program.fontCache, program.exeDir / "font", program.spriteCache)}
 {
 
 	menu.add({"Back To Game", [this](){ this->next = std::make_unique<GameState>(this->program); }});
@@ -93,9 +170,14 @@ PauseState::PauseState(Program &program)
 	ui.add(menu);
 }
 
+std::string_view PauseState::getName() const
+{
+	return "PauseState";
+}
+
 EditorState::EditorState(Program &program) : ProgramState{program},
-	status{{0.0, 0.9, 1.0, 0.05}, {textNormal, background}, program.exeDir / "font" / "DejaVuSansMono.ttf"},
-	message{{0.0, 0.95, 1.0, 0.05}, {textHighlight, background}, program.exeDir / "font" / "DejaVuSansMono.ttf"},
+	status{{0.0, 0.9, 1.0, 0.05}, {textNormal, background}, program.fontCache, program.exeDir / "font" / "DejaVuSansMono.ttf"},
+	message{{0.0, 0.95, 1.0, 0.05}, {textHighlight, background}, program.fontCache, program.exeDir / "font" / "DejaVuSansMono.ttf"},
 	editor{{0.0, 0.0, 1.0, 0.9}, program.logger, program.window, program.game, status.text, message.text, [this](){ this->next = std::make_unique<MenuState>(this->program); }}
 {
 	ui.add(status);
@@ -103,6 +185,11 @@ EditorState::EditorState(Program &program) : ProgramState{program},
 	ui.add(editor);
 }
 
+std::string_view EditorState::getName() const
+{
+	return "EditorState";
+}
+
 ExitState::ExitState(Program &program) : ProgramState{program}
 {
 }
@@ -112,26 +199,112 @@ std::unique_ptr<ProgramState> ExitState::handleEvent([[maybe_unused]] const SDL_
 	return nullptr;
 }
 
-void ExitState::update()
+void ExitState::update([[maybe_unused]] double alpha)
 {
 	return;
 }
 
-Program::Program(Log &logger, const fs::path &exeDir, sw::Window &window)
-	: logger{logger}, exeDir{exeDir}, window{window}, game{logger, exeDir}, state{std::make_unique<MenuState>(*this)}
+std::string_view ExitState::getName() const
+{
+	return "ExitState";
+}
+
+Program::Program(Log &logger, const fs::path &exeDir, sw::Window &window, FontCache &fontCache, SpriteCache &spriteCache)
+	: logger{logger}, exeDir{exeDir}, window{window}, fontCache{fontCache}, spriteCache{spriteCache}, game{logger, exeDir}, state{std::make_unique<MenuState>(*this)}, accumulator{0.0},
+	  latency{logger}, overlay{{0.0, 0.0, 0.5, 0.5}, latency, fontCache, exeDir / "font" / "DejaVuSansMono.ttf"}, showOverlay{false}
 {
+	overlay.reInit(window.getSurface().getWidth(), window.getSurface().getHeight());
 }
 
 void Program::handleEvent(const SDL_Event &event)
 {
+	SAL_PROFILE("Program::handleEvent");
+	latency.handled(event, state->getName());
+	if (   event.type == SDL_KEYDOWN && !event.key.repeat
+	    && event.key.keysym.scancode == SDL_SCANCODE_F3)
+	{
+		showOverlay = !showOverlay;
+		if (!showOverlay)
+		{
+			state->damageArea(overlay.getReal());
+			window.addDamage(&overlay.getReal());
+		}
+		return;
+	}
+	if (   event.type == SDL_KEYDOWN && !event.key.repeat
+	    && event.key.keysym.scancode == SDL_SCANCODE_F4)
+	{
+		try
+		{
+			Trace::toggle();
+			WRITE_LOG(logger, Log::info, "Program: tracing " << (Trace::isEnabled() ? "started" : "stopped") << std::endl);
+		}
+		catch (const std::runtime_error &exception)
+		{
+			WRITE_LOG(logger, Log::warning, exception.what() << std::endl);
+		}
+		return;
+	}
+	if (   event.type == SDL_KEYDOWN && !event.key.repeat
+	    && event.key.keysym.scancode == SDL_SCANCODE_F5)
+	{
+		logger.dumpRecorder();
+		WRITE_LOG(logger, Log::info, "Program: dumped flight recorder" << std::endl);
+		return;
+	}
+
 	std::unique_ptr<ProgramState> nextState{state->handleEvent(event)};
 	if (nextState)
+	{
 		state = std::move(nextState);
+		// Time spent in the previous state is not simulated
+		frameTimer.reset();
+		accumulator = 0.0;
+	}
 }
 
 void Program::update()
 {
-	state->update();
+	accumulator += frameTimer.elapsed();
+	frameTimer.reset();
+
+	int steps{0};
+	while (accumulator >= timestep && steps < maxSteps)
+	{
+		state->step(timestep);
+		accumulator -= timestep;
+		++steps;
+	}
+	// Too far behind, drop the time that cannot be caught up with
+	if (accumulator >= timestep)
+		accumulator = std::fmod(accumulator, timestep);
+
+	state->update(accumulator / timestep);
+
+	if (showOverlay)
+	{
+		overlay.draw(window.getSurface());
+		window.addDamage(&overlay.getReal());
+	}
+	latency.drawn();
+}
+
+void Program::reInit()
+{
+	state->reInit();
+	overlay.reInit(window.getSurface().getWidth(), window.getSurface().getHeight());
+	// Drop the fonts in sizes no longer used
+	fontCache.collect();
+}
+
+void Program::presented(bool presented)
+{
+	latency.presented(presented);
+}
+
+bool Program::isIdle()
+{
+	return !showOverlay && state->isIdle();
 }
 
 bool Program::isExited()
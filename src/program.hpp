@@ -11,7 +11,10 @@
 
 #include "editor.hpp"
 #include "game.hpp"
+#include "profile_overlay.hpp"
+#include "timer.hpp"
 #include "ui.hpp"
+#include "vec.hpp"
 #include <filesystem>
 #include <memory>
 #include <string>
@@ -37,7 +40,22 @@ public:
 	 */
 	// TODO: Remove virtual when GameState is completed
 	virtual std::unique_ptr<ProgramState> handleEvent(const SDL_Event &event);
-	virtual void update();
+	// Advance the simulation by a fixed timestep of dt seconds
+	virtual void step(double dt);
+	/*
+	 * Draw the current frame,
+	 * alpha is how far (in [0, 1)) the frame is between the last two steps.
+	 */
+	virtual void update(double alpha);
+
+	// Called when the window surface changed, such as on resizing
+	virtual void reInit();
+	// Name shown in statistics such as latency
+	virtual std::string_view getName() const = 0;
+	// Return true if nothing changes until the next event
+	virtual bool isIdle();
+	// Draw the area again after something drawn over the state is gone
+	void damageArea(const sw::Rect &area);
 };
 
 class MenuState : public ProgramState
@@ -49,8 +67,13 @@ private:
 	 */
 	class Background: public Widget
 	{
+	private:
+		// Rendered once so that drawing respects the clip rectangle
+		sw::Surface cache;
+
 	public:
 		using Widget::Widget;
+		void reInit(int wScreen, int hScreen) final;
 		void draw(sw::Surface &surface) final;
 	};
 	Background background;
@@ -59,18 +82,31 @@ private:
 
 public:
 	MenuState(Program &program);
+	std::string_view getName() const override;
 };
 
 // TODO: Finish GameState (currently a placeholder)
 class GameState : public ProgramState
 {
 private:
+	// Position is relative to the space the text can move within, velocity is per second
+	struct Body
+	{
+		Vec2d position;
+		Vec2d velocity;
+	};
+
 	sw::Surface line1;
+	Body previous;
+	Body current;
 
 public:
 	GameState(Program &program);
 	std::unique_ptr<ProgramState> handleEvent(const SDL_Event &event) override;
-	void update() override;
+	void step(double dt) override;
+	void update(double alpha) override;
+	bool isIdle() override;
+	std::string_view getName() const override;
 };
 
 class PauseState : public ProgramState
@@ -80,6 +116,7 @@ private:
 
 public:
 	PauseState(Program &program);
+	std::string_view getName() const override;
 };
 
 class EditorState : public ProgramState
@@ -95,6 +132,7 @@ private:
 
 public:
 	EditorState(Program &program);
+	std::string_view getName() const override;
 };
 
 class ExitState : public ProgramState
@@ -102,7 +140,8 @@ class ExitState : public ProgramState
 public:
 	ExitState(Program &program);
 	std::unique_ptr<ProgramState> handleEvent([[maybe_unused]] const SDL_Event &event) override;
-	void update() override;
+	void update(double alpha) override;
+	std::string_view getName() const override;
 };
 
 class Program
@@ -111,15 +150,36 @@ public:
 	Log &logger;
 	const fs::path &exeDir;
 	sw::Window &window;
+	FontCache &fontCache;
+	SpriteCache &spriteCache;
 	Game game;
 
 private:
+	/*
+	 * The simulation runs in fixed steps regardless of frame rate,
+	 * with at most maxSteps per frame so that slow frames do not fall further and further behind.
+	 */
+	static constexpr double timestep{1.0 / 120.0};
+	static constexpr int maxSteps{8};
+
 	std::unique_ptr<ProgramState> state;
+	Timer frameTimer;
+	double accumulator;
+
+	LatencyTracker latency;
+
+	// Toggled by F3, tracing is toggled by F4
+	ProfileOverlay overlay;
+	bool showOverlay;
 
 public:
-	Program(Log &logger, const fs::path &exeDir, sw::Window &window);
+	Program(Log &logger, const fs::path &exeDir, sw::Window &window, FontCache &fontCache, SpriteCache &spriteCache);
 	void handleEvent(const SDL_Event &event);
 	void update();
+	void reInit();
+	// Called after Window::update(), presented is its result
+	void presented(bool presented);
+	bool isIdle();
 	bool isExited();
 };
 
@@ -0,0 +1,38 @@
+#include "settings.hpp"
+#include <algorithm>
+#include <initializer_list>
+#include <vector>
+
+namespace
+{
+	auto positive{[](int value) { return value > 0; }};
+	auto notNegative{[](int value) { return value >= 0; }};
+
+	std::function<bool(const std::string&)> oneOf(std::initializer_list<const char*> choices)
+	{
+		std::vector<std::string> allowed{choices.begin(), choices.end()};
+		return [allowed](const std::string &value)
+		       {
+		       	return std::find(allowed.begin(), allowed.end(), value) != allowed.end();
+		       };
+	}
+}
+
+Settings::Settings(Config &config)
+	: windowWidth{config.declare<int>("window.width", 640, positive)},
+	  windowHeight{config.declare<int>("window.height", 480, positive)},
+	  windowResizable{config.declare<bool>("window.resizable", true)},
+	  fontPreload{config.declare<std::string>("font.preload", "")},
+	  spriteCacheBytes{config.declare<std::size_t>("ui.spriteCacheBytes", 32 << 20)},
+	  frameMode{config.declare<std::string>("frame.mode", "paced", oneOf({"paced", "uncapped"}))},
+	  frameRate{config.declare<int>("frame.rate", 0, notNegative)},
+	  frameIdle{config.declare<bool>("frame.idle", true)},
+	  frameIdleTimeout{config.declare<int>("frame.idleTimeout", 500, positive)},
+	  traceFile{config.declare<std::string>("trace.file", "saltfish.trace.json")},
+	  traceEnable{config.declare<bool>("trace.enable", false)},
+	  logOverflow{config.declare<std::string>("log.overflow", "block", oneOf({"block", "drop", "count"}))},
+	  logBinary{config.declare<std::string>("log.binary", "")},
+	  logRecorder{config.declare<std::size_t>("log.recorder", 1024)},
+	  logRecorderFile{config.declare<std::string>("log.recorderFile", "saltfish.recorder.log")}
+{
+}
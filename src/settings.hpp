@@ -0,0 +1,37 @@
+#ifndef SETTINGS_HPP
+#define SETTINGS_HPP
+
+#include "config.hpp"
+#include <cstddef>
+#include <string>
+
+/*
+ * The keys of saltfish.conf used by the program,
+ * declared before the file is loaded, see Config::declare().
+ */
+struct Settings
+{
+	Config::Handle<int> windowWidth;
+	Config::Handle<int> windowHeight;
+	Config::Handle<bool> windowResizable;
+
+	Config::Handle<std::string> fontPreload; // comma-separated file names in font/
+	Config::Handle<std::size_t> spriteCacheBytes;
+
+	Config::Handle<std::string> frameMode; // paced or uncapped
+	Config::Handle<int> frameRate;         // Hz, 0 for the refresh rate of the display
+	Config::Handle<bool> frameIdle;
+	Config::Handle<int> frameIdleTimeout;  // ms
+
+	Config::Handle<std::string> traceFile;
+	Config::Handle<bool> traceEnable;
+
+	Config::Handle<std::string> logOverflow; // block, drop, or count
+	Config::Handle<std::string> logBinary;   // empty for text
+	Config::Handle<std::size_t> logRecorder; // messages per thread, 0 to disable
+	Config::Handle<std::string> logRecorderFile;
+
+	Settings(Config &config);
+};
+
+#endif // ifndef SETTINGS_HPP
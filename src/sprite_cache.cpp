@@ -0,0 +1,98 @@
+#include "sprite_cache.hpp"
+
+bool SpriteCache::Key::operator==(const Key &key) const
+{
+	auto sameColor{[](const sw::Color &a, const sw::Color &b)
+	               {
+	               	return a.r == b.r && a.g == b.g && a.b == b.b && a.a == b.a;
+	               }};
+	return    font == key.font && content == key.content
+	       && width == key.width && height == key.height
+	       && sameColor(color.first, key.color.first) && sameColor(color.second, key.color.second);
+}
+
+std::size_t SpriteCache::KeyHash::operator()(const Key &key) const
+{
+	std::size_t hash{std::hash<std::string>{}(key.font)};
+	// Same mixing as boost::hash_combine
+	auto combine{[&hash](std::size_t value)
+	             {
+	             	hash ^= value + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+	             }};
+	combine(std::hash<std::string>{}(key.content));
+	combine(std::hash<int>{}(key.width));
+	combine(std::hash<int>{}(key.height));
+	for (const sw::Color &c : {key.color.first, key.color.second})
+	{
+		combine(std::hash<Uint32>{}(  static_cast<Uint32>(c.r) << 24 | static_cast<Uint32>(c.g) << 16
+		                            | static_cast<Uint32>(c.b) << 8  | static_cast<Uint32>(c.a)));
+	}
+	return hash;
+}
+
+std::size_t SpriteCache::spriteSize(const Sprite &sprite)
+{
+	return static_cast<std::size_t>(sprite->getPitch()) * static_cast<std::size_t>(sprite->getHeight());
+}
+
+void SpriteCache::evict()
+{
+	while (used > budget && !entries.empty())
+	{
+		used -= spriteSize(entries.back().second);
+		index.erase(entries.back().first);
+		entries.pop_back();
+	}
+}
+
+SpriteCache::SpriteCache(std::size_t budget) : budget{budget}, used{0}
+{
+}
+
+SpriteCache::Sprite SpriteCache::find(const Key &key)
+{
+	auto it{index.find(key)};
+	if (it == index.end())
+		return nullptr;
+
+	entries.splice(entries.begin(), entries, it->second);
+	return it->second->second;
+}
+
+SpriteCache::Sprite SpriteCache::insert(const Key &key, sw::Surface surface)
+{
+	Sprite sprite{std::make_shared<sw::Surface>(std::move(surface))};
+
+	auto it{index.find(key)};
+	if (it != index.end())
+	{
+		used -= spriteSize(it->second->second);
+		entries.erase(it->second);
+		index.erase(it);
+	}
+
+	entries.emplace_front(key, sprite);
+	index.emplace(key, entries.begin());
+	used += spriteSize(sprite);
+	evict();
+
+	return sprite;
+}
+
+void SpriteCache::clear()
+{
+	entries.clear();
+	index.clear();
+	used = 0;
+}
+
+void SpriteCache::setBudget(std::size_t budget)
+{
+	this->budget = budget;
+	evict();
+}
+
+std::size_t SpriteCache::getUsed()
+{
+	return used;
+}
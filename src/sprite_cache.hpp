@@ -0,0 +1,65 @@
+#ifndef SPRITE_CACHE_HPP
+#define SPRITE_CACHE_HPP
+
+#include "surface.hpp"
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+/*
+ * A process-wide cache of prerendered surfaces (sprites) of widgets,
+ * such as the items of a menu in each of their states.
+ *
+ * Sprites are evicted in least recently used order when the total size
+ * exceeds the budget (in bytes).
+ * NOTE: Evicted sprites still in use stay alive until released,
+ *       only sprites held by the cache count towards the budget.
+ */
+class SpriteCache
+{
+public:
+	using Sprite = std::shared_ptr<sw::Surface>;
+
+	struct Key
+	{
+		std::string font;    // Identifies the font, such as the font path and size
+		std::string content; // Such as the text rendered
+		int width;
+		int height;
+		sw::ColorPair color;
+
+		bool operator==(const Key &key) const;
+	};
+
+private:
+	struct KeyHash
+	{
+		std::size_t operator()(const Key &key) const;
+	};
+
+	using Entry = std::pair<Key, Sprite>;
+
+	std::size_t budget;
+	std::size_t used;
+	std::list<Entry> entries; // Most recently used first
+	std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> index;
+
+	static std::size_t spriteSize(const Sprite &sprite);
+	void evict();
+
+public:
+	SpriteCache(std::size_t budget);
+
+	// Return nullptr if not cached
+	Sprite find(const Key &key);
+	Sprite insert(const Key &key, sw::Surface surface);
+	void clear();
+
+	void setBudget(std::size_t budget);
+	std::size_t getUsed();
+};
+
+#endif // ifndef SPRITE_CACHE_HPP
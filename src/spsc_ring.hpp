@@ -0,0 +1,47 @@
+#ifndef SPSC_RING_HPP
+#define SPSC_RING_HPP
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * A fixed-size lock-free ring buffer for ONE producer thread and ONE consumer thread
+ * The producer never waits, items pushed into a full ring are dropped.
+ */
+template <typename T, std::size_t size>
+class SpscRing
+{
+private:
+	static_assert(size > 0 && (size & (size - 1)) == 0, "SpscRing size must be a power of 2");
+
+	std::array<T, size> items;
+	std::atomic<std::uint64_t> head{0}; // written by the producer
+	std::atomic<std::uint64_t> tail{0}; // written by the consumer
+
+public:
+	// Producer only, return false if the item is dropped
+	bool push(const T &item)
+	{
+		std::uint64_t position{head.load(std::memory_order_relaxed)};
+		if (position - tail.load(std::memory_order_acquire) >= size)
+			return false;
+		items[position & (size - 1)] = item;
+		head.store(position + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Consumer only, call function on each item pushed so far
+	template <typename Function>
+	void drain(Function function)
+	{
+		std::uint64_t position{tail.load(std::memory_order_relaxed)};
+		std::uint64_t end{head.load(std::memory_order_acquire)};
+		for (; position != end; ++position)
+			function(items[position & (size - 1)]);
+		tail.store(position, std::memory_order_release);
+	}
+};
+
+#endif // ifndef SPSC_RING_HPP
@@ -1,4 +1,5 @@
 #include "surface.hpp"
+#include "trace.hpp"
 
 namespace sw // Sdl_Wrapper
 {
@@ -9,8 +10,7 @@ Surface::Surface(SDL_Surface *surface) : surface{surface}, managed{true}
 
 Surface::Surface(Surface &&surface) : surface{surface.getPtr()}, managed{surface.getManaged()}
 {
-	if (surface.getPtr())
-		surface.free();
+	surface.surface = nullptr;
 }
 
 Surface::Surface(int width, int height, int depth, Uint32 format) : surface{nullptr}, managed{true}
@@ -41,6 +41,7 @@ void Surface::create(int width, int height, int depth, Uint32 format)
 		message += SDL_GetError();
 		throw std::runtime_error{message};
 	}
+	SAL_COUNT(Trace::surfacesAllocated, 1);
 }
 
 void Surface::create(void *pixels, int width, int height, int depth, int pitch, Uint32 format)
@@ -210,6 +211,19 @@ void Surface::setRLE(bool flag)
 	}
 }
 
+void Surface::setBlendMode(SDL_BlendMode blendMode)
+{
+	if (!surface)
+		throw std::runtime_error{"Surface::setBlendMode() failed: surface is nullptr"};
+
+	if (SDL_SetSurfaceBlendMode(surface, blendMode) < 0)
+	{
+		std::string message{"Surface::setBlendMode() failed: "};
+		message += SDL_GetError();
+		throw std::runtime_error{message};
+	}
+}
+
 void Surface::setManaged(bool flag)
 {
 	managed = flag;
@@ -224,7 +238,7 @@ Surface& Surface::operator=(Surface &&surface)
 {
 	if (this != &surface)
 	{
-		if (this->surface)
+		if (this->surface && managed)
 			free();
 		this->surface = surface.surface;
 		this->managed = surface.managed;
@@ -46,6 +46,7 @@ public:
 	void unlock();
 	bool getMustLock();
 	void setRLE(bool flag);
+	void setBlendMode(SDL_BlendMode blendMode);
 	void setManaged(bool flag);
 	bool getManaged();
 
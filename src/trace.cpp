@@ -0,0 +1,225 @@
+#include "trace.hpp"
+#include <stdexcept>
+#include <string>
+
+const std::array<const char*, Trace::counterCount> Trace::counterNames{
+	"lines drawn",
+	"pixels written",
+	"surfaces allocated"
+};
+
+std::atomic<bool> Trace::enabled{false};
+std::array<std::atomic<std::int64_t>, Trace::counterCount> Trace::counters{};
+
+std::mutex Trace::ringsMutex;
+std::vector<std::unique_ptr<Trace::Ring> > Trace::rings;
+thread_local Trace::LocalRing Trace::localRing;
+
+std::filesystem::path Trace::path{"saltfish.trace.json"};
+std::ofstream Trace::file;
+bool Trace::firstEvent{true};
+std::vector<const char*> Trace::writtenNames;
+std::thread Trace::flusher;
+std::mutex Trace::flusherMutex;
+std::condition_variable Trace::flusherWake;
+bool Trace::flusherStop{false};
+
+// Finish the trace file when the program exits while tracing
+static struct TraceStopper
+{
+	~TraceStopper()
+	{
+		Trace::stop();
+	}
+} traceStopper;
+
+Trace::LocalRing::~LocalRing()
+{
+	if (ring)
+		ring->used.store(false, std::memory_order_release);
+}
+
+Trace::Ring& Trace::getRing()
+{
+	if (!localRing.ring)
+	{
+		std::lock_guard<std::mutex> lock{ringsMutex};
+		for (auto &ring : rings)
+		{
+			if (!ring->used.load(std::memory_order_acquire))
+			{
+				ring->used.store(true, std::memory_order_relaxed);
+				localRing.ring = ring.get();
+				break;
+			}
+		}
+		if (!localRing.ring)
+		{
+			rings.push_back(std::make_unique<Ring>());
+			rings.back()->id = static_cast<int>(rings.size());
+			localRing.ring = rings.back().get();
+		}
+		localRing.ring->name.store(localRing.name, std::memory_order_release);
+	}
+	return *localRing.ring;
+}
+
+void Trace::push(const Event &event)
+{
+	// Dropped if the flusher falls behind
+	getRing().events.push(event);
+}
+
+void Trace::writeString(const char *string)
+{
+	file << '"';
+	for (; *string; ++string)
+	{
+		if (*string == '"' || *string == '\\')
+			file << '\\';
+		file << *string;
+	}
+	file << '"';
+}
+
+void Trace::beginEvent()
+{
+	if (!firstEvent)
+		file << ",\n";
+	firstEvent = false;
+}
+
+void Trace::flush()
+{
+	std::lock_guard<std::mutex> lock{ringsMutex};
+	writtenNames.resize(rings.size(), nullptr);
+	for (std::size_t i{0}; i < rings.size(); ++i)
+	{
+		Ring &ring{*rings[i]};
+
+		const char *name{ring.name.load(std::memory_order_acquire)};
+		if (name && name != writtenNames[i])
+		{
+			beginEvent();
+			file << R"({"ph":"M","pid":1,"tid":)" << ring.id << R"(,"name":"thread_name","args":{"name":)";
+			writeString(name);
+			file << "}}";
+			writtenNames[i] = name;
+		}
+
+		// Timestamps are in microseconds
+		ring.events.drain([&ring](const Event &event)
+		                  {
+		                  	beginEvent();
+		                  	switch (event.type)
+		                  	{
+		                  	case Event::complete:
+		                  		file << R"({"ph":"X","pid":1,"tid":)" << ring.id
+		                  		     << R"(,"ts":)" << event.time / 1000.0
+		                  		     << R"(,"dur":)" << event.value / 1000.0 << R"(,"name":)";
+		                  		writeString(event.name);
+		                  		file << '}';
+		                  		break;
+
+		                  	case Event::counter:
+		                  		file << R"({"ph":"C","pid":1,"tid":)" << ring.id
+		                  		     << R"(,"ts":)" << event.time / 1000.0 << R"(,"name":)";
+		                  		writeString(event.name);
+		                  		file << R"(,"args":{"value":)" << event.value << "}}";
+		                  		break;
+		                  	}
+		                  });
+	}
+	file.flush();
+}
+
+void Trace::flushLoop()
+{
+	std::unique_lock<std::mutex> lock{flusherMutex};
+	while (!flusherStop)
+	{
+		flusherWake.wait_for(lock, flushInterval);
+		flush();
+	}
+}
+
+void Trace::setPath(const std::filesystem::path &path)
+{
+	Trace::path = path;
+}
+
+void Trace::setThreadName(const char *name)
+{
+	localRing.name = name;
+	if (localRing.ring)
+		localRing.ring->name.store(name, std::memory_order_release);
+}
+
+void Trace::start()
+{
+	if (isEnabled())
+		return;
+
+	file.open(path, std::ios::trunc);
+	if (!file)
+		throw std::runtime_error{"Trace::start() failed: cannot open \"" + path.string() + '\"'};
+	file << std::fixed;
+	file.precision(3);
+	file << "{\"traceEvents\":[\n";
+	firstEvent = true;
+	writtenNames.clear();
+
+	// Discard what was left from the last trace
+	{
+		std::lock_guard<std::mutex> lock{ringsMutex};
+		for (auto &ring : rings)
+			ring->events.drain([](const Event&){});
+	}
+	for (auto &counter : counters)
+		counter.store(0, std::memory_order_relaxed);
+
+	flusherStop = false;
+	flusher = std::thread{flushLoop};
+	enabled.store(true, std::memory_order_release);
+}
+
+void Trace::stop()
+{
+	if (!isEnabled())
+		return;
+
+	enabled.store(false, std::memory_order_release);
+	{
+		std::lock_guard<std::mutex> lock{flusherMutex};
+		flusherStop = true;
+	}
+	flusherWake.notify_one();
+	flusher.join();
+
+	flush();
+	file << "\n]}\n";
+	file.close();
+}
+
+void Trace::toggle()
+{
+	if (isEnabled())
+		stop();
+	else
+		start();
+}
+
+void Trace::zone(const char *name, tick_t begin, tick_t end)
+{
+	push({Event::complete, name, begin, end - begin});
+}
+
+void Trace::endFrame(tick_t begin, tick_t end)
+{
+	if (!isEnabled())
+		return;
+
+	push({Event::complete, "frame", begin, end - begin});
+	for (std::size_t i{0}; i < counterCount; ++i)
+		push({Event::counter, counterNames[i], end, counters[i].exchange(0, std::memory_order_relaxed)});
+}
@@ -0,0 +1,137 @@
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+#include "spsc_ring.hpp"
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * Streams profiling zones, counters and thread names into a JSON trace file,
+ * which can be loaded by chrome://tracing or Perfetto.
+ *
+ * While tracing, each thread appends events to its own lock-free ring,
+ * and a background thread writes them out periodically,
+ * so that tracing barely affects the timings it captures.
+ *
+ * SAL_COUNT(Trace::counter, n) adds n to a counter,
+ * its per-frame value is written as a counter event at the end of every frame.
+ * Like SAL_PROFILE(), it expands to nothing unless SALTFISH_PROFILE is defined.
+ */
+#ifdef SALTFISH_PROFILE
+#define SAL_COUNT(counter, n) Trace::count(counter, n)
+#else
+#define SAL_COUNT(counter, n) ((void)0)
+#endif
+
+class Trace
+{
+public:
+	enum Counter
+	{
+		linesDrawn,
+		pixelsWritten,
+		surfacesAllocated,
+		counterCount
+	};
+
+	// Nanoseconds, same as Profiler::tick_t
+	using tick_t = std::int64_t;
+
+private:
+	struct Event
+	{
+		enum Type : char
+		{
+			complete, // a zone from begin to end
+			counter
+		};
+
+		Type type;
+		const char *name;
+		tick_t time;
+		tick_t value; // duration for complete events
+	};
+
+	struct Ring
+	{
+		SpscRing<Event, 8192> events;
+		int id;
+		std::atomic<const char*> name{nullptr};
+		// false after the owning thread exits, so the ring can be taken by another thread
+		std::atomic<bool> used{true};
+	};
+
+	// Gives the ring of a thread back when the thread exits
+	struct LocalRing
+	{
+		Ring *ring{nullptr};
+		const char *name{nullptr};
+
+		~LocalRing();
+	};
+
+	static constexpr std::chrono::milliseconds flushInterval{50};
+	static const std::array<const char*, counterCount> counterNames;
+
+	static std::atomic<bool> enabled;
+	static std::array<std::atomic<std::int64_t>, counterCount> counters;
+
+	/*
+	 * Rings are never freed, as a thread may still be writing into one when tracing stops,
+	 * but the ring of an exited thread is reused by the next thread needing one.
+	 * A thread only takes a ring when it first records an event while tracing.
+	 */
+	static std::mutex ringsMutex;
+	static std::vector<std::unique_ptr<Ring> > rings;
+	static thread_local LocalRing localRing;
+
+	// Only touched by the main thread, and the flusher while running
+	static std::filesystem::path path;
+	static std::ofstream file;
+	static bool firstEvent;
+	static std::vector<const char*> writtenNames;
+	static std::thread flusher;
+	static std::mutex flusherMutex;
+	static std::condition_variable flusherWake;
+	static bool flusherStop;
+
+	static Ring& getRing();
+	static void push(const Event &event);
+	static void flush();
+	static void flushLoop();
+	static void writeString(const char *string);
+	static void beginEvent();
+
+public:
+	// Where the trace is written when started by toggle()
+	static void setPath(const std::filesystem::path &path);
+	// Name the calling thread in traces, name must outlive the program
+	static void setThreadName(const char *name);
+
+	static void start();
+	static void stop();
+	static void toggle();
+	static bool isEnabled()
+	{
+		return enabled.load(std::memory_order_relaxed);
+	}
+
+	static void zone(const char *name, tick_t begin, tick_t end);
+	static void count(Counter counter, std::int64_t n)
+	{
+		if (isEnabled())
+			counters[counter].fetch_add(n, std::memory_order_relaxed);
+	}
+	// Called by the main thread at the end of every frame
+	static void endFrame(tick_t begin, tick_t end);
+};
+
+#endif // ifndef TRACE_HPP
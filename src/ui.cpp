@@ -1,6 +1,11 @@
 #include "ui.hpp"
+#include "profiler.hpp"
 
-Widget::Widget(const DoubleRect &dimension) : dimension{dimension}
+Widget::Widget(const DoubleRect &dimension) : damaged{true}, dimension{dimension}
+{
+}
+
+Widget::~Widget()
 {
 }
 
@@ -10,43 +15,208 @@ void Widget::reInit(int wScreen, int hScreen)
 	real.y = dimension.y * hScreen;
 	real.w = dimension.w * wScreen;
 	real.h = dimension.h * hScreen;
+	damaged = true;
+}
+
+Widget::EventMask Widget::eventCategory(Uint32 type)
+{
+	switch (type)
+	{
+	case SDL_KEYDOWN:
+	case SDL_KEYUP:
+		return keyEvent;
+
+	case SDL_TEXTINPUT:
+	case SDL_TEXTEDITING:
+		return textEvent;
+
+	case SDL_MOUSEMOTION:
+	case SDL_MOUSEBUTTONDOWN:
+	case SDL_MOUSEBUTTONUP:
+		return pointerEvent;
+
+	case SDL_MOUSEWHEEL:
+		return wheelEvent;
+
+	default:
+		return noEvent;
+	}
 }
 
 void Widget::handleEvent([[maybe_unused]] const SDL_Event &event)
 {
 }
 
-TextBar::TextBar(const DoubleRect &dimension, const sw::ColorPair &color, const std::filesystem::path &fontPath)
-	: Widget{dimension}, fontPath{fontPath}, color{color}
+unsigned Widget::getEventMask()
+{
+	return noEvent;
+}
+
+const sw::Rect& Widget::getReal()
+{
+	return real;
+}
+
+void Widget::damage()
+{
+	damaged = true;
+}
+
+bool Widget::isDamaged()
+{
+	return damaged;
+}
+
+bool Widget::isAnimating()
+{
+	return false;
+}
+
+void Widget::clearDamage()
+{
+	damaged = false;
+}
+
+TextBar::TextBar(const DoubleRect &dimension, const sw::ColorPair &color, FontCache &fontCache, const std::filesystem::path &fontPath)
+	: Widget{dimension}, fontCache{fontCache}, fontPath{fontPath}, color{color}
+{
+}
+
+static bool sameColor(const sw::ColorPair &c0, const sw::ColorPair &c1)
+{
+	auto same{[](const sw::Color &a, const sw::Color &b)
+	          {
+	          	return a.r == b.r && a.g == b.g && a.b == b.b && a.a == b.a;
+	          }};
+	return same(c0.first, c1.first) && same(c0.second, c1.second);
+}
+
+sw::Surface TextBar::render(const std::string &text, int width, int height, const sw::ColorPair &color, sw::Font &font)
+{
+	sw::Surface bar{width, height};
+	// Copy the background as is instead of blending it
+	bar.setBlendMode(SDL_BLENDMODE_NONE);
+	bar.fillRect(nullptr, color.second);
+	if (!text.empty())
+	{
+		sw::Surface textRender(font.renderBlended(text, color.first));
+		sw::Rect dstRect{0, static_cast<int>(height * (1.0 - fontScale) * 0.5), 0, 0};
+		textRender.blit(bar, nullptr, &dstRect);
+	}
+	return bar;
+}
+
+void TextBar::updateCache()
+{
+	// Nothing can be kept if the color changed
+	if (!sameColor(cacheColor, color))
+		cacheText.clear();
+
+	if (!cache)
+	{
+		cache.create(real.w, real.h);
+		// Copy the background as is instead of blending it
+		cache.setBlendMode(SDL_BLENDMODE_NONE);
+		cacheText.clear();
+	}
+
+	// The rendered part shared with the new text is kept
+	std::size_t common{0};
+	while (   common < cacheText.size() && common < text.size()
+	       && cacheText[common] == text[common])
+		++common;
+
+	int offset{0};
+	if (common > 0)
+	{
+		std::string prefix{text, 0, common};
+		font->sizeText(prefix, &offset, nullptr);
+	}
+
+	sw::Rect changed{offset, 0, real.w - offset, real.h};
+	cache.fillRect(&changed, color.second);
+	if (common < text.size())
+	{
+		std::string suffix{text, common};
+		sw::Surface textRender(font->renderBlended(suffix, color.first));
+		sw::Rect dstRect{offset, static_cast<int>(real.h * (1.0 - fontScale) * 0.5), 0, 0};
+		textRender.blit(cache, nullptr, &dstRect);
+	}
+
+	cacheText = text;
+	cacheColor = color;
+}
+
+bool TextBar::isCacheCurrent()
 {
+	return cache && cacheText == text && sameColor(cacheColor, color);
 }
 
 void TextBar::reInit(int wScreen, int hScreen)
 {
 	Widget::reInit(wScreen, hScreen);
-	if (font)
-		font.close();
-	font.open(fontPath, static_cast<int>(real.h * fontScale));
+	font = fontCache.get(fontPath, static_cast<int>(real.h * fontScale));
+
+	// The cache has to be rendered again with the new dimension,
+	// without an old one, it is simply rendered by the next draw().
+	if (cache)
+		placeholder = std::move(cache);
+	if (placeholder)
+	{
+		jobText = text;
+		jobColor = color;
+		renderJob.start([text{jobText}, color{jobColor}, width{real.w}, height{real.h}, font{font}]
+		                ([[maybe_unused]] const std::atomic<bool> &cancelled)
+		                {
+		                	return render(text, width, height, color, *font);
+		                });
+	}
 }
 
 void TextBar::draw(sw::Surface &surface)
 {
-	surface.fillRect(&real, color.second);
-	if (text.size() > 0)
+	SAL_PROFILE("TextBar::draw");
+	if (renderJob.ready())
 	{
-		sw::Surface textRender(font.renderBlended(text, color.first));
-		sw::Rect dstRect{real.x, real.y + static_cast<int>(real.h * (1.0 - fontScale) * 0.5), 0, 0};
-		textRender.blit(surface, nullptr, &dstRect);
+		cache = renderJob.take();
+		cacheText = jobText;
+		cacheColor = jobColor;
+		placeholder.free();
 	}
+
+	sw::Rect dstRect{real};
+	if (renderJob.pending())
+	{
+		placeholder.blitScaled(surface, nullptr, &dstRect);
+		return;
+	}
+
+	if (!isCacheCurrent())
+		updateCache();
+	cache.blit(surface, nullptr, &dstRect);
+}
+
+bool TextBar::isDamaged()
+{
+	if (renderJob.pending())
+		return damaged || renderJob.ready();
+	return damaged || !isCacheCurrent();
+}
+
+bool TextBar::isAnimating()
+{
+	return renderJob.pending();
 }
 
 Menu::Item::Item(std::string_view text, std::function<void()> onActivation, bool enable)
-	: text{text}, onActivation{onActivation}, enable{enable}
+	: text{text}, onActivation{onActivation}, spriteKeys{}, spriteEnable{enable}, enable{enable}
 {
 }
 
 Menu::Item::Item(const Item &item)
-	: text{item.text}, onActivation{item.onActivation}, enable{item.enable}
+	: text{item.text}, onActivation{item.onActivation},
+	  sprites{item.sprites}, spriteKeys{item.spriteKeys}, spriteEnable{item.spriteEnable},
+	  enable{item.enable}
 {
 }
 
@@ -54,21 +224,30 @@ Menu::Item& Menu::Item::operator=(const Menu::Item &item)
 {
 	text = item.text;
 	onActivation = item.onActivation;
+	sprites = item.sprites;
+	spriteKeys = item.spriteKeys;
+	spriteEnable = item.spriteEnable;
 	enable = item.enable;
 	return *this;
 }
 
-void Menu::Item::update(int width, int height, const sw::ColorPair &color, sw::Font &font)
+const std::string& Menu::Item::getText()
 {
-	if (cache)
-		cache.free();
-	cache.create(width, height);
-	cache.fillRect(nullptr, color.second);
+	return text;
+}
+
+sw::Surface Menu::Item::render(std::string_view text, int width, int height, const sw::ColorPair &color, sw::Font &font)
+{
+	sw::Surface render{width, height};
+	render.fillRect(nullptr, color.second);
 
 	// The space is for preventing the text from sticking to the left
-	sw::Surface textRender{font.renderBlended(' ' + text, color.first)};
+	std::string padded{' '};
+	padded += text;
+	sw::Surface textRender{font.renderBlended(padded, color.first)};
 	sw::Rect dstRect{0, static_cast<int>(height * (1.0 - fontScale) * 0.5), 0, 0};
-	textRender.blit(cache, nullptr, &dstRect);
+	textRender.blit(render, nullptr, &dstRect);
+	return render;
 }
 
 void Menu::Item::activate()
@@ -77,33 +256,82 @@ void Menu::Item::activate()
 		onActivation();
 }
 
-void Menu::updateItem(int index)
+const sw::ColorPair& Menu::stateColor(bool enable, bool selected)
 {
-	if (index == noSelected)
-		return;
+	if (selected)
+		return enable ? selectedColor : disabledSelectedColor;
+	else
+		return enable ? normalColor : disabledNormalColor;
+}
+
+SpriteCache::Key Menu::spriteKey(int index, int state)
+{
+	return {fontPath.string() + ':' + std::to_string(fontSize),
+	        items[index].getText(), real.w, itemHeightReal,
+	        stateColor(items[index].enable, state == 1)};
+}
 
-	if (index == selected)
+bool Menu::spritesUpToDate(int index)
+{
+	for (int state{0}; state < 2; ++state)
 	{
-		if (items[index].enable)
-		{
-			items[index].update(real.w, itemHeightReal, selectedColor, font);
-		}
-		else
-		{
-			items[index].update(real.w, itemHeightReal, disabledSelectedColor, font);
-		}
+		if (!items[index].sprites[state] || !(items[index].spriteKeys[state] == spriteKey(index, state)))
+			return false;
 	}
-	else
+	return true;
+}
+
+void Menu::prerenderItem(int index)
+{
+	Item &item{items[index]};
+	for (int state{0}; state < 2; ++state)
 	{
-		if (items[index].enable)
-		{
-			items[index].update(real.w, itemHeightReal, normalColor, font);
-		}
-		else
+		SpriteCache::Key key{spriteKey(index, state)};
+		SpriteCache::Sprite sprite{spriteCache.find(key)};
+		if (!sprite)
+			sprite = spriteCache.insert(key, Item::render(key.content, key.width, key.height, key.color, *font));
+		item.sprites[state] = sprite;
+		item.spriteKeys[state] = std::move(key);
+	}
+	item.spriteEnable = item.enable;
+	damage();
+}
+
+void Menu::finishSpriteJob()
+{
+	std::vector<sw::Surface> rendered{spriteJob.take()};
+	for (std::size_t i{0}; i < rendered.size(); ++i)
+	{
+		const SpriteRequest &request{spriteJobRequests[i]};
+		SpriteCache::Sprite sprite{spriteCache.insert(request.key, std::move(rendered[i]))};
+
+		// Items may be added or removed during rendering
+		if (   request.index < static_cast<int>(items.size())
+		    && spriteKey(request.index, request.state) == request.key)
 		{
-			items[index].update(real.w, itemHeightReal, disabledNormalColor, font);
+			items[request.index].sprites[request.state] = sprite;
+			items[request.index].spriteKeys[request.state] = request.key;
 		}
 	}
+	spriteJobRequests.clear();
+
+	for (int i{0}; i < static_cast<int>(items.size()); ++i)
+	{
+		if (!spritesUpToDate(i))
+			prerenderItem(i);
+	}
+	damage();
+}
+
+void Menu::updateItem(int index)
+{
+	if (index == noSelected)
+		return;
+
+	damage();
+	// Both states are already prerendered unless enable changed
+	if (items[index].enable != items[index].spriteEnable)
+		prerenderItem(index);
 }
 
 int Menu::itemUnderCursor(int x, int y)
@@ -125,11 +353,12 @@ int Menu::itemUnderCursor(int x, int y)
 		return noSelected;
 }
 
-Menu::Menu(const DoubleRect &dimension, double itemHeight, double gapHeight, const sw::ColorPair &normalColor, const sw::ColorPair &selectedColor, const sw::ColorPair &disabledNormalColor, const sw::ColorPair &disabledSelectedColor, const std::filesystem::path &fontPath)
+Menu::Menu(const DoubleRect &dimension, double itemHeight, double gapHeight, const sw::ColorPair &normalColor, const sw::ColorPair &selectedColor, const sw::ColorPair &disabledNormalColor, const sw::ColorPair &disabledSelectedColor, FontCache &fontCache, const std::filesystem::path &fontPath, SpriteCache &spriteCache)
 	: Widget{dimension}, itemHeight{itemHeight}, gapHeight{gapHeight},
 	  normalColor{normalColor}, selectedColor{selectedColor},
 	  disabledNormalColor{disabledNormalColor}, disabledSelectedColor{disabledSelectedColor},
-	  fontPath{fontPath}, selected{noSelected}
+	  fontCache{fontCache}, fontPath{fontPath}, spriteCache{spriteCache}, selected{noSelected},
+	  itemHeightReal{0}, gapHeightReal{0}, fontSize{0}
 {
 }
 
@@ -139,11 +368,58 @@ void Menu::reInit(int wScreen, int hScreen)
 	itemHeightReal = static_cast<int>(itemHeight * hScreen);
 	gapHeightReal  = static_cast<int>(gapHeight * hScreen);
 
-	if (font) font.close();
-	font.open(fontPath, static_cast<int>(itemHeight * hScreen * Item::fontScale));
+	fontSize = static_cast<int>(itemHeight * hScreen * Item::fontScale);
+	font = fontCache.get(fontPath, fontSize);
 
+	// Sprites already in spriteCache are used directly
+	std::vector<SpriteRequest> requests;
 	for (int i{0}; i < static_cast<int>(items.size()); ++i)
-		updateItem(i);
+	{
+		for (int state{0}; state < 2; ++state)
+		{
+			SpriteCache::Key key{spriteKey(i, state)};
+			SpriteCache::Sprite sprite{spriteCache.find(key)};
+			if (sprite)
+			{
+				items[i].sprites[state] = sprite;
+				items[i].spriteKeys[state] = std::move(key);
+			}
+			else
+			{
+				requests.push_back({i, state, std::move(key)});
+			}
+		}
+		items[i].spriteEnable = items[i].enable;
+	}
+
+	spriteJob.cancel();
+	spriteJobRequests.clear();
+	if (requests.empty())
+		return;
+
+	bool placeholder{true};
+	for (const SpriteRequest &request : requests)
+		placeholder = placeholder && items[request.index].sprites[request.state];
+
+	// Without anything to show meanwhile, the sprites are simply rendered now
+	if (!placeholder)
+	{
+		for (int i{0}; i < static_cast<int>(items.size()); ++i)
+			prerenderItem(i);
+		return;
+	}
+
+	spriteJobRequests = std::move(requests);
+	spriteJob.start([requests{spriteJobRequests}, font{font}](const std::atomic<bool> &cancelled)
+	                {
+	                	std::vector<sw::Surface> rendered;
+	                	for (std::size_t i{0}; i < requests.size() && !cancelled; ++i)
+	                	{
+	                		const SpriteCache::Key &key{requests[i].key};
+	                		rendered.push_back(Item::render(key.content, key.width, key.height, key.color, *font));
+	                	}
+	                	return rendered;
+	                });
 }
 
 void Menu::handleEvent(const SDL_Event &event)
@@ -232,16 +508,38 @@ void Menu::handleEvent(const SDL_Event &event)
 	}
 }
 
+unsigned Menu::getEventMask()
+{
+	return keyEvent | pointerEvent;
+}
+
 void Menu::draw(sw::Surface &surface)
 {
-	sw::Rect current{real.x, real.y, 0, 0};
-	for (std::size_t i{0}; i < items.size(); ++i)
+	for (int i{0}; i < static_cast<int>(items.size()); ++i)
 	{
-		items[i].cache.blit(surface, nullptr, &current);
-		current.y += itemHeightReal + gapHeightReal;
+		const SpriteCache::Sprite &sprite{items[i].sprites[i == selected ? 1 : 0]};
+		if (!sprite)
+			continue;
+
+		// NOTE: blit() overwrites dstrect with the clipped rectangle
+		// Sprites from before reInit() are scaled to the new size
+		sw::Rect current{real.x, real.y + i * (itemHeightReal + gapHeightReal), real.w, itemHeightReal};
+		sprite->blitScaled(surface, nullptr, &current);
 	}
 }
 
+bool Menu::isDamaged()
+{
+	if (spriteJob.ready())
+		finishSpriteJob();
+	return damaged;
+}
+
+bool Menu::isAnimating()
+{
+	return spriteJob.pending();
+}
+
 void Menu::add(const Item &item, int index)
 {
 	static const double epsilon{0.01};
@@ -254,6 +552,14 @@ void Menu::add(const Item &item, int index)
 		items.push_back(item);
 	else
 		items.insert(items.begin() + index, item);
+	damage();
+
+	// Only prerender after reInit()
+	if (font)
+	{
+		int inserted{index == end ? static_cast<int>(items.size()) - 1 : (index == begin ? 0 : index)};
+		prerenderItem(inserted);
+	}
 }
 
 void Menu::remove(int index)
@@ -272,40 +578,239 @@ void Menu::remove(int index)
 			selected = noSelected;
 		items.erase(items.begin() + index);
 	}
+	damage();
+}
+
+std::mutex UI::instancesMutex;
+std::vector<UI*> UI::instances;
+std::atomic<unsigned> UI::filterMask{Widget::noEvent};
+
+int UI::eventFilter([[maybe_unused]] void *userdata, SDL_Event *event)
+{
+	// NOTE: This may be called from another thread
+	Widget::EventMask category{Widget::eventCategory(event->type)};
+	if (category == Widget::noEvent)
+		return 1;
+	return (filterMask.load(std::memory_order_relaxed) & category) != 0;
 }
 
-UI::UI(sw::Surface &surface) : surface{&surface}
+void UI::updateFilterMask()
 {
+	std::lock_guard<std::mutex> lock{instancesMutex};
+	unsigned mask{Widget::noEvent};
+	for (const UI *ui : instances)
+		mask |= ui->acceptedEvents;
+	filterMask.store(mask, std::memory_order_relaxed);
 }
 
-void UI::reInit(sw::Surface &surface)
+void UI::rebuildDispatch()
 {
-	this->surface = &surface;
+	unsigned mask{extraMask};
+	hitOrder.clear();
+	for (auto it{widgets.rbegin()}; it != widgets.rend(); ++it)
+	{
+		unsigned widgetMask{(*it)->getEventMask()};
+		mask |= widgetMask;
+		if (widgetMask & (Widget::pointerEvent | Widget::wheelEvent))
+			hitOrder.push_back(*it);
+	}
+
+	acceptedEvents = mask;
+	updateFilterMask();
+}
+
+Widget* UI::hitTest(int x, int y, Widget::EventMask category)
+{
+	SDL_Point point{x, y};
+	for (Widget *widget : hitOrder)
+	{
+		if ((widget->getEventMask() & category) && SDL_PointInRect(&point, &widget->getReal()))
+			return widget;
+	}
+	return nullptr;
+}
+
+UI::UI(sw::Window &window)
+	: window{&window}, focused{nullptr}, captured{nullptr}, xMouse{0}, yMouse{0}, extraMask{Widget::noEvent}, acceptedEvents{Widget::noEvent}
+{
+	{
+		std::lock_guard<std::mutex> lock{instancesMutex};
+		instances.push_back(this);
+	}
+	rebuildDispatch();
+}
+
+UI::~UI()
+{
+	{
+		std::lock_guard<std::mutex> lock{instancesMutex};
+		instances.erase(std::find(instances.begin(), instances.end(), this));
+	}
+	updateFilterMask();
+}
+
+void UI::reInit(sw::Window &window)
+{
+	this->window = &window;
+	sw::Surface &surface{window.getSurface()};
 	for (auto &widget : widgets)
-		widget->reInit(surface.getWidth(), surface.getWidth());
+		widget->reInit(surface.getWidth(), surface.getHeight());
+	rebuildDispatch();
 }
 
 void UI::update()
 {
+	SAL_PROFILE("UI::update");
+	damage.clear();
 	for (auto &widget : widgets)
-		widget->draw(*surface);
+	{
+		if (widget->isDamaged())
+			damage.push_back(widget->getReal());
+	}
+	sw::mergeRects(damage);
+	if (damage.empty())
+		return;
+
+	// Widgets are drawn from bottom to top, so a widget is drawn again
+	// when anything under or above it within the damaged area changed.
+	sw::Surface &surface{window->getSurface()};
+	for (auto &widget : widgets)
+	{
+		for (const sw::Rect &rect : damage)
+		{
+			sw::Rect clip;
+			if (SDL_IntersectRect(&widget->getReal(), &rect, &clip))
+			{
+				surface.setClipRect(&clip);
+				widget->draw(surface);
+			}
+		}
+		widget->clearDamage();
+	}
+	surface.setClipRect(nullptr);
+
+	for (const sw::Rect &rect : damage)
+		window->addDamage(&rect);
 }
 
-void UI::handleEvent(const SDL_Event &event)
+bool UI::isIdle()
 {
 	for (auto &widget : widgets)
-		widget->handleEvent(event);
+	{
+		if (widget->isDamaged() || widget->isAnimating())
+			return false;
+	}
+	return true;
+}
+
+void UI::damageArea(const sw::Rect &area)
+{
+	for (auto &widget : widgets)
+	{
+		if (SDL_HasIntersection(&widget->getReal(), &area))
+			widget->damage();
+	}
+}
+
+void UI::handleEvent(const SDL_Event &event)
+{
+	// The window surface still holds the last frame, it only has to be presented again
+	if (event.type == SDL_WINDOWEVENT && event.window.event == SDL_WINDOWEVENT_EXPOSED)
+		window->addDamage(nullptr);
+
+	Widget::EventMask category{Widget::eventCategory(event.type)};
+	switch (category)
+	{
+	case Widget::pointerEvent:
+	{
+		if (event.type == SDL_MOUSEMOTION)
+		{
+			xMouse = event.motion.x;
+			yMouse = event.motion.y;
+		}
+		else
+		{
+			xMouse = event.button.x;
+			yMouse = event.button.y;
+		}
+
+		Widget *target{captured ? captured : hitTest(xMouse, yMouse, category)};
+		if (event.type == SDL_MOUSEBUTTONDOWN && target)
+		{
+			captured = target;
+			if (target->getEventMask() & (Widget::keyEvent | Widget::textEvent))
+				focused = target;
+		}
+		else if (event.type == SDL_MOUSEBUTTONUP)
+		{
+			captured = nullptr;
+		}
+
+		if (target)
+			target->handleEvent(event);
+		break;
+	}
+
+	case Widget::wheelEvent:
+	{
+		// Wheel events have no position, use the last known one
+		Widget *target{captured ? captured : hitTest(xMouse, yMouse, category)};
+		if (target && (target->getEventMask() & category))
+			target->handleEvent(event);
+		break;
+	}
+
+	case Widget::keyEvent:
+	case Widget::textEvent:
+		if (focused && (focused->getEventMask() & category))
+			focused->handleEvent(event);
+		break;
+
+	default:
+		for (auto &widget : widgets)
+			widget->handleEvent(event);
+		break;
+	}
 }
 
 void UI::add(Widget &widget)
 {
 	widgets.push_back(&widget);
-	widget.reInit(surface->getWidth(), surface->getHeight());
+	sw::Surface &surface{window->getSurface()};
+	widget.reInit(surface.getWidth(), surface.getHeight());
+
+	if (!focused && (widget.getEventMask() & (Widget::keyEvent | Widget::textEvent)))
+		focused = &widget;
+	rebuildDispatch();
 }
 
 void UI::remove(Widget &widget)
 {
 	widgets.remove(&widget);
+	if (focused == &widget)
+		focused = nullptr;
+	if (captured == &widget)
+		captured = nullptr;
+	rebuildDispatch();
+
+	// Expose whatever was under the widget
+	for (auto &other : widgets)
+	{
+		if (SDL_HasIntersection(&other->getReal(), &widget.getReal()))
+			other->damage();
+	}
+	window->addDamage(&widget.getReal());
+}
+
+void UI::requireEvents(unsigned mask)
+{
+	extraMask |= mask;
+	rebuildDispatch();
+}
+
+void UI::installEventFilter()
+{
+	SDL_SetEventFilter(eventFilter, nullptr);
 }
 
 static const sw::ColorPair normalColor{{255, 255, 255, 255}, {80, 80, 80, 240}};
@@ -313,10 +818,10 @@ static const sw::ColorPair selectedColor{{255, 130, 0, 255}, {255, 255, 255, 240
 static const sw::ColorPair disabledNormalColor{{80, 80, 80, 255}, {120, 120, 120, 240}};
 static const sw::ColorPair disabledSelectedColor{{120, 120, 120, 255}, {180, 180, 180, 240}};
 
-Menu makeMainMenu(const DoubleRect &dimension, double itemHeight, double gapHeight, const std::filesystem::path &fontDir)
+Menu makeMainMenu(const DoubleRect &dimension, double itemHeight, double gapHeight, FontCache &fontCache, const std::filesystem::path &fontDir, SpriteCache &spriteCache)
 {
 	return {dimension, itemHeight, gapHeight,
 	        normalColor, selectedColor, disabledNormalColor, disabledSelectedColor,
-	        fontDir / "Terminus-Bold.ttf"};
+	        fontCache, fontDir / "Terminus-Bold.ttf", spriteCache};
 }
 
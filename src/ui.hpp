@@ -6,8 +6,14 @@
 #ifndef UI_HPP
 #define UI_HPP
 
-#include "font.hpp"
+#include "background_job.hpp"
+#include "font_cache.hpp"
+#include "sprite_cache.hpp"
 #include "window.hpp"
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <vector>
 
 /*
  * x, y: origin(left upper corner) coordinates
@@ -23,50 +29,113 @@ struct DoubleRect
 
 class Widget
 {
+public:
+	// Categories of events a widget may handle, combined as bits
+	enum EventMask : unsigned
+	{
+		noEvent      = 0,
+		keyEvent     = 1 << 0, // SDL_KEYDOWN, SDL_KEYUP
+		textEvent    = 1 << 1, // SDL_TEXTINPUT, SDL_TEXTEDITING
+		pointerEvent = 1 << 2, // SDL_MOUSEMOTION, SDL_MOUSEBUTTONDOWN, SDL_MOUSEBUTTONUP
+		wheelEvent   = 1 << 3  // SDL_MOUSEWHEEL
+	};
+
+	// Category of an event type, noEvent for events not dispatched by category
+	static EventMask eventCategory(Uint32 type);
+
 protected:
 	// The REAL dimension ON SCREEN (in px)
 	sw::Rect real;
 
+	// true if the widget has to be drawn again
+	bool damaged;
+
 public:
 	// Dimension proportional to each axis of screen
 	const DoubleRect dimension;
 
 	Widget(const DoubleRect &dimension);
+	virtual ~Widget();
 
 	// This method is exposed to allow a Widget to be reinitialized in events such as resizing
 	virtual void reInit(int wScreen, int hScreen);
 
 	// NOTE: A widget may have no associated event handler
 	virtual void handleEvent([[maybe_unused]] const SDL_Event &event);
+	// Only events in these categories are sent to handleEvent(),
+	// a widget handling no events returns noEvent.
+	virtual unsigned getEventMask();
 
 	// NOTE: It's up to the IMPLEMENTER to USE real FOR CLIPPING
+	//       The clip rectangle of surface is set to the damaged part by UI,
+	//       so drawing through blit() and fillRect() is preferred.
 	virtual void draw(sw::Surface &surface) = 0;
+
+	const sw::Rect& getReal();
+
+	// Request the whole widget to be drawn again
+	void damage();
+	// A widget may override this to check for changes only when asked
+	virtual bool isDamaged();
+	// A widget changing without events (such as waiting for a background render)
+	// returns true, so that the main loop keeps running frames instead of sleeping.
+	virtual bool isAnimating();
+	// Called by UI after drawing
+	void clearDamage();
 };
 
 /*
  * A bar to display ONE line of text
  * Can be used for displaying entered command like command mode in Vim
+ *
+ * The rendered bar is cached, and only updated when the text or color changes.
+ * When only the end of the text changes (such as typing into a prompt),
+ * only the changed suffix is rendered again.
+ * After reInit(), the bar is rendered in the background,
+ * while the old cache is scaled as a placeholder.
  */
 class TextBar : public Widget
 {
 private:
+	FontCache &fontCache;
 	std::filesystem::path fontPath;
-	sw::Font font;
+	FontCache::Handle font;
 	sw::ColorPair color;
 
+	sw::Surface cache;
+	std::string cacheText;    // The text currently rendered in cache
+	sw::ColorPair cacheColor; // The color currently rendered in cache
+
+	sw::Surface placeholder;
+	BackgroundJob<sw::Surface> renderJob;
+	std::string jobText;    // The text rendered by renderJob
+	sw::ColorPair jobColor; // The color rendered by renderJob
+
+	static sw::Surface render(const std::string &text, int width, int height, const sw::ColorPair &color, sw::Font &font);
+	void updateCache();
+	// true if cache holds the current text and color
+	bool isCacheCurrent();
+
 public:
 	static constexpr double fontScale{0.75}; // fontHeight / itemHeight
 
 	std::string text;
 
-	TextBar(const DoubleRect &dimension, const sw::ColorPair &color, const std::filesystem::path &fontPath);
+	TextBar(const DoubleRect &dimension, const sw::ColorPair &color, FontCache &fontCache, const std::filesystem::path &fontPath);
 	void reInit(int wScreen, int hScreen) override;
 	void draw(sw::Surface &surface) override;
+	bool isDamaged() override;
+	bool isAnimating() override;
 };
 
 /*
  * A simple menu with a list of Items like buttons,
  * can be navigated with mouse and arrow keys.
+ * Each item is prerendered in both states it can be shown in (selected or not),
+ * and the sprites are shared with other menus through SpriteCache,
+ * so moving the selection does no rendering.
+ * After reInit(), the sprites missing from SpriteCache are rendered in the background,
+ * while the old sprites are scaled as placeholders.
  */
 class Menu final : public Widget
 {
@@ -80,18 +149,21 @@ public:
 	public:
 		static constexpr double fontScale{0.75}; // fontHeight / itemHeight
 
-		// Prevent rendering multiple times
-		// Only updated when the "selected" status change
-		sw::Surface cache;
+		// Prerendered sprites and their keys in SpriteCache,
+		// [0] for not selected, [1] for selected.
+		std::array<SpriteCache::Sprite, 2> sprites;
+		std::array<SpriteCache::Key, 2> spriteKeys;
+		bool spriteEnable; // enable when the sprites were rendered
 
 		bool enable;
 
-
 		Item(std::string_view text, std::function<void()> onActivation, bool enable = true);
 		Item(const Item &item);
 		Item& operator=(const Item &item);
 
-		void update(int width, int height, const sw::ColorPair &color, sw::Font &font);
+		const std::string& getText();
+		// NOTE: This can be called from a worker thread
+		static sw::Surface render(std::string_view text, int width, int height, const sw::ColorPair &color, sw::Font &font);
 		void activate(); // An Item can activated by the parent Menu
 	};
 
@@ -104,15 +176,33 @@ private:
 	sw::ColorPair disabledNormalColor;
 	sw::ColorPair disabledSelectedColor;
 
+	FontCache &fontCache;
 	std::filesystem::path fontPath;
+	SpriteCache &spriteCache;
 	std::vector<Item> items;
 	int selected;
 	static constexpr int noSelected{-1};
 
 	int itemHeightReal; // Height of each Item
 	int gapHeightReal; // Gap between Items
-	sw::Font font;
+	int fontSize;
+	FontCache::Handle font;
 
+	// Sprites missing from spriteCache after reInit(), rendered by spriteJob
+	struct SpriteRequest
+	{
+		int index;
+		int state;
+		SpriteCache::Key key;
+	};
+	BackgroundJob<std::vector<sw::Surface> > spriteJob;
+	std::vector<SpriteRequest> spriteJobRequests;
+
+	const sw::ColorPair& stateColor(bool enable, bool selected);
+	SpriteCache::Key spriteKey(int index, int state);
+	bool spritesUpToDate(int index);
+	void prerenderItem(int index);
+	void finishSpriteJob();
 	void updateItem(int index);
 	int itemUnderCursor(int x, int y);
 
@@ -123,10 +213,13 @@ public:
 		end = -2
 	};
 
-	Menu(const DoubleRect &dimension, double itemHeight, double gapHeight, const sw::ColorPair &normalColor, const sw::ColorPair &selectedColor, const sw::ColorPair &disabledNormalColor, const sw::ColorPair &disabledSelectedColor, const std::filesystem::path &fontPath);
+	Menu(const DoubleRect &dimension, double itemHeight, double gapHeight, const sw::ColorPair &normalColor, const sw::ColorPair &selectedColor, const sw::ColorPair &disabledNormalColor, const sw::ColorPair &disabledSelectedColor, FontCache &fontCache, const std::filesystem::path &fontPath, SpriteCache &spriteCache);
 	void reInit(int wScreen, int hScreen) override;
 	void handleEvent(const SDL_Event &event) override;
+	unsigned getEventMask() override;
 	void draw(sw::Surface &surface) override;
+	bool isDamaged() override;
+	bool isAnimating() override;
 	void add(const Item &item, int index = end);
 	void remove(int index = end);
 };
@@ -134,20 +227,67 @@ public:
 /*
  * Simple UI engine,
  * forwards event and update each widget.
+ *
+ * Only widgets overlapping a damaged widget are drawn again,
+ * and only the damaged part of the window is presented.
+ *
+ * Events are only sent to the widgets asking for them:
+ * pointer events go to the topmost widget under the cursor
+ * (or the widget that received the button down until the button is released),
+ * keyboard and text events go to the focused widget,
+ * other events are sent to every widget.
+ * Events no widget of any UI asks for are dropped by the SDL event filter.
  */
 class UI
 {
 private:
-	sw::Surface *surface;
+	sw::Window *window;
 	std::list<Widget*> widgets;
+	std::vector<sw::Rect> damage;
+
+	// Widgets asking for pointer or wheel events, topmost first
+	std::vector<Widget*> hitOrder;
+	Widget *focused;  // Receives keyboard and text events
+	Widget *captured; // Receives pointer events while a button is held down
+	int xMouse;
+	int yMouse;
+
+	// Events handled by the ProgramState itself instead of widgets
+	unsigned extraMask;
+
+	// Event categories asked for by the widgets and the owner
+	unsigned acceptedEvents;
+
+	// All UIs, the event filter accepts the union of their acceptedEvents
+	static std::mutex instancesMutex;
+	static std::vector<UI*> instances;
+	static std::atomic<unsigned> filterMask;
+	static int eventFilter(void *userdata, SDL_Event *event);
+	static void updateFilterMask();
+
+	void rebuildDispatch();
+	Widget* hitTest(int x, int y, Widget::EventMask category);
 
 public:
-	UI(sw::Surface &surface);
-	void reInit(sw::Surface &surface);
+	UI(sw::Window &window);
+	UI(const UI&) = delete;
+	UI& operator=(const UI&) = delete;
+	~UI();
+	void reInit(sw::Window &window);
 	void update();
 	void handleEvent(const SDL_Event &event);
 	void add(Widget &widget);
 	void remove(Widget &widget);
+	// Nothing to draw until the next event
+	bool isIdle();
+	// Draw the widgets within area again, such as after something drawn over them is gone
+	void damageArea(const sw::Rect &area);
+
+	// Also accept these events for the owner of the UI, see Widget::EventMask
+	void requireEvents(unsigned mask);
+
+	// Install the filter dropping unwanted events, call once after SDL_Init()
+	static void installEventFilter();
 };
 
 /*
@@ -158,7 +298,7 @@ public:
 /*
  * MainMenu is the menu displayed after the game started, and after pausing the game.
  */
-Menu makeMainMenu(const DoubleRect &dimension, double itemHeight, double gapHeight, const std::filesystem::path &fontDir);
+Menu makeMainMenu(const DoubleRect &dimension, double itemHeight, double gapHeight, FontCache &fontCache, const std::filesystem::path &fontDir, SpriteCache &spriteCache);
 
 #endif // ifndef UI_HPP
 
@@ -3,9 +3,9 @@
 namespace sw // Sdl Wrapper
 {
 
-Window::Window(Log &logger, const std::string &title, const Config &config) : logger{logger}, window{nullptr}
+Window::Window(Log &logger, const std::string &title, const Settings &settings) : logger{logger}, window{nullptr}, resized{false}
 {
-	init(title, config);
+	init(title, settings);
 }
 
 Window::~Window()
@@ -13,18 +13,17 @@ Window::~Window()
 	cleanup();
 }
 
-void Window::init(const std::string &title, const Config &config)
+void Window::init(const std::string &title, const Settings &settings)
 {
 	if (window)
 		throw std::runtime_error{"Window::init() failed: window already exist"};
 
-	int width{640}, height{480};
-	config.get("window.width", width);
-	config.get("window.height", height);
+	int width{settings.windowWidth.get()}, height{settings.windowHeight.get()};
 
 	WRITE_LOG(logger, Log::info, "Initialize video mode: " << width << 'x' << height << std::endl);
 
-	window = SDL_CreateWindow(title.c_str() , SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, width, height, 0);
+	window = SDL_CreateWindow(title.c_str() , SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, width, height,
+	                          settings.windowResizable.get() ? SDL_WINDOW_RESIZABLE : 0);
 	if (!window)
 	{
 		std::string message{"SDL_CreateWindow() Error: "};
@@ -63,16 +62,63 @@ Surface& Window::getSurface()
 	return surface;
 }
 
-void Window::update()
+void Window::handleEvent(const SDL_Event &event)
+{
+	if (   event.type == SDL_WINDOWEVENT
+	    && event.window.event == SDL_WINDOWEVENT_SIZE_CHANGED
+	    && event.window.windowID == SDL_GetWindowID(window))
+		resized = true;
+}
+
+bool Window::refreshSurface()
+{
+	if (!window)
+		throw std::runtime_error{"Window::refreshSurface() failed: window is nullptr"};
+	if (!resized)
+		return false;
+	resized = false;
+
+	surface = SDL_GetWindowSurface(window);
+	if (!surface)
+	{
+		std::string message{"SDL_GetWindowSurface() Error: "};
+		message += SDL_GetError();
+		throw std::runtime_error{message};
+	}
+	surface.setManaged(false);
+
+	WRITE_LOG(logger, Log::debug, "Window resized to " << surface.getWidth() << 'x' << surface.getHeight() << std::endl);
+
+	damage.clear();
+	addDamage(nullptr);
+	return true;
+}
+
+void Window::addDamage(const Rect *rect)
+{
+	if (rect)
+		damage.push_back(*rect);
+	else
+		damage.push_back({0, 0, getSurface().getWidth(), getSurface().getHeight()});
+}
+
+bool Window::update()
 {
 	if (!window)
 		throw std::runtime_error{"Window::update() failed: window is nullptr"};
-	if (SDL_UpdateWindowSurface(window) < 0)
+
+	mergeRects(damage);
+	if (damage.empty())
+		return false;
+
+	if (SDL_UpdateWindowSurfaceRects(window, damage.data(), static_cast<int>(damage.size())) < 0)
 	{
 		std::string message{"Window::update() failed: "};
 		message += SDL_GetError();
 		throw std::runtime_error{message};
 	}
+	damage.clear();
+	return true;
 }
 
 Window::operator bool()
@@ -1,8 +1,8 @@
 #ifndef WINDOW_HPP
 #define WINDOW_HPP
 
-#include "config.hpp"
 #include "log.hpp"
+#include "settings.hpp"
 #include "surface.hpp"
 #include <SDL.h>
 
@@ -20,15 +20,35 @@ private:
 	SDL_Window *window;
 	Surface surface;
 
+	// Parts of the surface changed since the last update()
+	std::vector<Rect> damage;
+
+	// Size changes are only applied once per frame by refreshSurface()
+	bool resized;
+
 public:
-	Window(Log &logger, const std::string &title, const Config &config);
+	Window(Log &logger, const std::string &title, const Settings &settings);
 	~Window();
 
-	void init(const std::string &title, const Config &config);
+	void init(const std::string &title, const Settings &settings);
 	void cleanup();
 	SDL_Window* getPtr();
 	Surface& getSurface();
-	void update();
+
+	// Record resizing of the window, can be called with any event
+	void handleEvent(const SDL_Event &event);
+	// Acquire the surface again if the window has been resized since the last call,
+	// return true if the surface changed.
+	// NOTE: The surface is invalidated on resizing, DO NOT draw before calling this.
+	bool refreshSurface();
+
+	// Mark part of the surface to be presented by the next update(),
+	// nullptr for the whole surface.
+	void addDamage(const Rect *rect);
+
+	// Only present the damaged part of the surface, if any,
+	// return true if anything is presented.
+	bool update();
 	operator bool();
 };
 
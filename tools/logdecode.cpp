@@ -0,0 +1,55 @@
+#include "log.hpp"
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <vector>
+
+/*
+ * Usage: saltfish_logdecode file
+ *
+ * Turns a binary log written by Log::openBinary() into the text layout of Log,
+ * written to stdout.
+ */
+
+int main(int argc, char *argv[])
+{
+	if (argc != 2)
+	{
+		std::cerr << "Usage: " << argv[0] << " file" << std::endl;
+		return 2;
+	}
+
+	std::ifstream file{argv[1], std::ios::binary};
+	if (!file)
+	{
+		std::cerr << "Cannot open " << argv[1] << std::endl;
+		return 1;
+	}
+	std::vector<std::byte> buffer;
+	for (auto it{std::istreambuf_iterator<char>{file}}; it != std::istreambuf_iterator<char>{}; ++it)
+		buffer.push_back(static_cast<std::byte>(*it));
+
+	std::string_view magic{reinterpret_cast<const char*>(buffer.data()),
+	                       std::min(buffer.size(), Log::binaryMagic.size())};
+	if (magic != Log::binaryMagic)
+	{
+		std::cerr << argv[1] << " is not a binary log" << std::endl;
+		return 1;
+	}
+
+	LogDecoder decoder;
+	std::size_t index{Log::binaryMagic.size()};
+	try
+	{
+		while (index < buffer.size())
+			decoder.decode(buffer, index, std::cout);
+	}
+	catch (const std::exception &exception)
+	{
+		std::cout.flush();
+		std::cerr << "Corrupt log at byte " << index << ": " << exception.what() << std::endl;
+		return 1;
+	}
+
+	return 0;
+}